@@ -0,0 +1,439 @@
+/**
+ * @file assembler.cpp
+ * @author Adrian Goessl
+ * @brief This is the implementation of the parallel assembler
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/assembler.h"
+#include "../src/include/byteCode.h"
+#include "../src/include/parser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace AssemblerInternals;
+using namespace ByteCodeInternals;
+using namespace ParserInternals;
+using namespace std;
+
+
+/// @brief This is the constructor for the Assembler class
+/// @param _threads This is the number of worker threads, 0 for one per core
+/// @param _cacheDir Reference to the directory of the chunk cache, empty to cache in memory only
+Assembler::Assembler(int _threads, const string& _cacheDir)
+    : hits(0), misses(0), threads(_threads), cacheDir(_cacheDir)
+{
+    if (!cacheDir.empty())
+    {
+        filesystem::create_directories(cacheDir);
+    }
+}
+
+/// @brief This function assembles and links the input files, encoding them concurrently
+/// @param files Reference to the input file names, linked in this order
+/// @return Will return the linked image
+Image Assembler::assemble(const vector<string>& files)
+{
+    vector<Chunk> chunks(files.size());
+    vector<exception_ptr> errors(files.size());
+    atomic<size_t> next(0);
+
+    int workers = threads > 0 ? threads : static_cast<int>(max(1u, thread::hardware_concurrency()));
+    workers = static_cast<int>(min(static_cast<size_t>(workers), max(files.size(), static_cast<size_t>(1))));
+
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < files.size(); i = next++)
+        {
+            try
+            {
+                chunks[i] = load(files[i]);
+            }
+            catch (...)
+            {
+                errors[i] = current_exception();
+            }
+        }
+    };
+
+    vector<thread> pool;
+
+    for (int i = 1; i < workers; i++)
+    {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& t : pool)
+    {
+        t.join();
+    }
+
+    for (const auto& error : errors)
+    {
+        if (error)
+        {
+            rethrow_exception(error);
+        }
+    }
+
+    return link(chunks);
+}
+
+/// @brief This function returns the cache key of a source, which also covers the chunk format and the opcode table
+/// @param source Reference to the source text
+/// @return Will return the 64 bit FNV-1a hash
+uint64_t Assembler::hash(const string& source)
+{
+    uint64_t h = 14695981039346656037ull;
+
+    auto feed = [&h](unsigned char c)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+        feed(static_cast<unsigned char>(CHUNK_FORMAT_VERSION >> (8 * i)));
+        feed(static_cast<unsigned char>(ByteCode::NUM_OPCODES >> (8 * i)));
+    }
+
+    // the encoding depends on the mnemonics and operand counts, so a change of the opcode table invalidates the cache
+    for (int opcode = 1; opcode < ByteCode::NUM_OPCODES; opcode++)
+    {
+        for (const char* c = ByteCode::opName[opcode]; *c != '\0'; c++)
+        {
+            feed(static_cast<unsigned char>(*c));
+        }
+
+        feed(0);
+        feed(static_cast<unsigned char>(ByteCode::operands[opcode]));
+    }
+
+    for (char c : source)
+    {
+        feed(static_cast<unsigned char>(c));
+    }
+
+    return h;
+}
+
+/// @brief This function encodes the source of one file with the parser's encoder,
+/// labels that are not defined in the file are left to the linker
+/// @param file Reference to the file name, used in error messages
+/// @param source Reference to the source text
+/// @return Will return the chunk with addresses relative to its start
+Chunk Assembler::encode(const string& file, const string& source)
+{
+    istringstream in(source);
+    Encoding encoding = Parser::encode(in, file);
+
+    return Chunk{file, hash(source), move(encoding.code), move(encoding.labels),
+                 move(encoding.relocations), move(encoding.externs)};
+}
+
+/// @brief This function links chunks in order, relocating their code addresses and resolving labels across files.
+/// A label defined in several files stays local to each of them, the image lists its first definition
+/// @param chunks Reference to the chunks
+/// @return Will return the image, which starts at the label main or at address 0
+Image Assembler::link(const vector<Chunk>& chunks)
+{
+    Image image{{}, {}, 0};
+    vector<int> bases;
+    int size = 0;
+
+    for (const auto& chunk : chunks)
+    {
+        bases.push_back(size);
+        size += static_cast<int>(chunk.code.size());
+    }
+
+    // labels are local to their file, a name defined in several files is only an error when another file refers to it
+    map<string, string> ambiguous;
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        for (const auto& label : chunks[i].labels)
+        {
+            if (!image.labels.emplace(label.first, bases[i] + label.second).second)
+            {
+                ambiguous.emplace(label.first, chunks[i].file);
+            }
+        }
+    }
+
+    auto resolve = [&](const string& name, const string& where)
+    {
+        auto it = image.labels.find(name);
+
+        if (it == image.labels.end())
+        {
+            cerr << "Unknown label '" << name << "' " << where << "\n";
+            throw runtime_error("Unknown label.");
+        }
+
+        auto duplicate = ambiguous.find(name);
+
+        if (duplicate != ambiguous.end())
+        {
+            cerr << "Label '" << name << "' " << where << " is defined in more than one file, again in '"
+                 << duplicate->second << "'\n";
+            throw runtime_error("Duplicate label.");
+        }
+
+        return it->second;
+    };
+
+    image.code.reserve(size);
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        int base = bases[i];
+        image.code.insert(image.code.end(), chunks[i].code.begin(), chunks[i].code.end());
+
+        for (int at : chunks[i].relocations)
+        {
+            image.code[base + at] += base;
+        }
+
+        for (const auto& ext : chunks[i].externs)
+        {
+            image.code[base + ext.first] = resolve(ext.second, "in '" + chunks[i].file + "'");
+        }
+    }
+
+    image.entry = image.labels.count("main") != 0 ? resolve("main", "of the entry point") : 0;
+
+    return image;
+}
+
+/// @brief This function reads a file and returns its chunk, from the cache if its content did not change
+/// @param file Reference to the file name
+/// @return Will return the chunk
+Chunk Assembler::load(const string& file)
+{
+    ifstream fin(file);
+
+    if (!fin.is_open())
+    {
+        cerr << "Failed to open '" << file << "' file\n";
+        throw runtime_error("Failed to open the input file.");
+    }
+
+    ostringstream source;
+    source << fin.rdbuf();
+
+    uint64_t key = hash(source.str());
+    Chunk chunk;
+
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+
+        if (it != cache.end())
+        {
+            hits++;
+            chunk = it->second;
+            chunk.file = file;
+            return chunk;
+        }
+    }
+
+    if (readCache(key, chunk))
+    {
+        hits++;
+    }
+    else
+    {
+        chunk = encode(file, source.str());
+        misses++;
+        writeCache(chunk);
+    }
+
+    chunk.file = file;
+    chunk.key = key;
+
+    lock_guard<mutex> lock(cacheMutex);
+    cache[key] = chunk;
+
+    return chunk;
+}
+
+/// @brief This function returns the path of a cached chunk
+/// @param key This is the cache key
+/// @return Will return the path
+string Assembler::cachePath(uint64_t key) const
+{
+    ostringstream path;
+    path << cacheDir << "/" << hex << key << ".mvmo";
+
+    return path.str();
+}
+
+/// @brief This function reads a chunk from the disk cache
+/// @param key This is the cache key
+/// @param chunk Reference to the chunk to fill
+/// @return Will return false if the chunk is not cached or unreadable
+bool Assembler::readCache(uint64_t key, Chunk& chunk)
+{
+    if (cacheDir.empty())
+    {
+        return false;
+    }
+
+    ifstream fin(cachePath(key));
+    string magic;
+    int version = 0;
+    size_t count = 0;
+
+    if (!(fin >> magic >> version) || magic != "mvmo" || version != CHUNK_FORMAT_VERSION)
+    {
+        return false;
+    }
+
+    Chunk cached{"", key, {}, {}, {}, {}};
+
+    if (!(fin >> magic >> count) || magic != "code")
+    {
+        return false;
+    }
+
+    cached.code.resize(count);
+
+    for (auto& word : cached.code)
+    {
+        fin >> word;
+    }
+
+    if (!(fin >> magic >> count) || magic != "labels")
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        string name;
+        int addr = 0;
+        fin >> name >> addr;
+        cached.labels[name] = addr;
+    }
+
+    if (!(fin >> magic >> count) || magic != "relocations")
+    {
+        return false;
+    }
+
+    cached.relocations.resize(count);
+
+    for (auto& at : cached.relocations)
+    {
+        fin >> at;
+    }
+
+    if (!(fin >> magic >> count) || magic != "externs")
+    {
+        return false;
+    }
+
+    cached.externs.resize(count);
+
+    for (auto& ext : cached.externs)
+    {
+        fin >> ext.first >> ext.second;
+    }
+
+    if (!fin)
+    {
+        return false;
+    }
+
+    chunk = move(cached);
+
+    return true;
+}
+
+/// @brief This function returns the id of the running process, so assemblers in different
+/// processes sharing a cache directory never write the same temporary file
+/// @return Will return the process id
+static long processId()
+{
+#ifdef _WIN32
+    return static_cast<long>(_getpid());
+#else
+    return static_cast<long>(getpid());
+#endif
+}
+
+/// @brief This function writes a chunk to the disk cache, through a temporary file so readers never see a partial chunk
+/// @param chunk Reference to the chunk
+void Assembler::writeCache(const Chunk& chunk)
+{
+    if (cacheDir.empty())
+    {
+        return;
+    }
+
+    string path = cachePath(chunk.key);
+    string temporary = path + "." + to_string(processId()) + "." + to_string(std::hash<thread::id>{}(this_thread::get_id()));
+    bool written = false;
+
+    {
+        ofstream fout(temporary);
+
+        fout << "mvmo " << CHUNK_FORMAT_VERSION << "\n";
+        fout << "code " << chunk.code.size() << "\n";
+
+        for (int word : chunk.code)
+        {
+            fout << word << " ";
+        }
+
+        fout << "\nlabels " << chunk.labels.size() << "\n";
+
+        for (const auto& label : chunk.labels)
+        {
+            fout << label.first << " " << label.second << "\n";
+        }
+
+        fout << "relocations " << chunk.relocations.size() << "\n";
+
+        for (int at : chunk.relocations)
+        {
+            fout << at << " ";
+        }
+
+        fout << "\nexterns " << chunk.externs.size() << "\n";
+
+        for (const auto& ext : chunk.externs)
+        {
+            fout << ext.first << " " << ext.second << "\n";
+        }
+
+        written = static_cast<bool>(fout);
+    }
+
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,541 @@
+/**
+ * @file debugger.cpp
+ * @author Adrian Goessl
+ * @brief This is the implementation of the debugger
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/debugger.h"
+#include "../src/include/byteCode.h"
+
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+using namespace DebuggerInternals;
+using namespace ByteCodeInternals;
+using namespace std;
+
+
+/// @brief This is the constructor for the Debugger class
+/// @param _in Reference to the command input stream
+/// @param _out Reference to the output stream
+/// @param _labels Reference to the labels of the program, used for locations
+Debugger::Debugger(istream& _in, ostream& _out, const map<string, int>& _labels)
+    : in(_in), out(_out), labels(_labels), codeLength(0), lifted(-1), watchedGlobal(-1),
+    watchedValue(0), stepping(false), interactive(true)
+{
+
+}
+
+/// @brief This function lets the VM run on a patchable copy of its code and stops before the first instruction
+/// @param vm Reference to the VM
+void Debugger::attach(mVM::VM& vm)
+{
+    code.assign(vm.code, vm.code + vm.arraySize);
+    code.push_back(ByteCode::HALT);
+    codeLength = vm.arraySize;
+    vm.code = code.data();
+    vm.debugger = this;
+
+    if (vm.ip >= 0 && vm.ip < codeLength)
+    {
+        stepping = true;
+        stepSites.insert(vm.ip);
+        patch(vm.ip);
+    }
+}
+
+/// @brief This function is called by the VM when it reaches a BRK, with ip at the BRK
+/// @param vm Reference to the VM
+void Debugger::trap(mVM::VM& vm)
+{
+    int addr = vm.ip;
+    bool embedded = original.count(addr) == 0;
+    bool stop = embedded || breakpoints.count(addr) > 0 || (stepping && stepSites.count(addr) > 0);
+    set<int> sites;
+
+    // the previous instruction has executed, so its site and the temporary step sites can be restored
+    sites.swap(stepSites);
+
+    for (int site : sites)
+    {
+        if (!wanted(site))
+        {
+            unpatch(site);
+        }
+    }
+
+    if (lifted >= 0 && wanted(lifted))
+    {
+        patch(lifted);
+    }
+    lifted = -1;
+
+    if (watchedGlobal >= 0)
+    {
+        int value = vm.globals[watchedGlobal];
+
+        if (value != watchedValue)
+        {
+            out << "watch g[" << watchedGlobal << "]: " << watchedValue << " -> " << value << "\n";
+            stop = true;
+        }
+
+        watchedGlobal = -1;
+    }
+
+    char command = 'c';
+
+    if (stop && interactive)
+    {
+        where(addr);
+        command = prompt(vm);
+    }
+
+    if (command == 'q')
+    {
+        vm.ip = codeLength;
+        return;
+    }
+
+    // a brk assembled into the program has no original instruction, it is skipped
+    if (embedded)
+    {
+        vm.ip = addr + 1;
+        stepping = command == 's';
+
+        if (stepping && vm.ip < codeLength)
+        {
+            stepSites.insert(vm.ip);
+            patch(vm.ip);
+        }
+        return;
+    }
+
+    resume(vm, addr, command == 's');
+}
+
+/// @brief This function lets the instruction at a trap execute and arms its successors when needed
+/// @param vm Reference to the VM
+/// @param addr This is the address of the trap
+/// @param step This is true to stop again after the instruction
+void Debugger::resume(mVM::VM& vm, int addr, bool step)
+{
+    int opcode = opcodeAt(addr);
+    vector<int> next;
+
+    stepping = step;
+    unpatch(addr);
+
+    if (wanted(addr))
+    {
+        lifted = addr;
+    }
+
+    if (opcode == ByteCode::GSTORE && watchpoints.count(code[addr + 1]) > 0)
+    {
+        watchedGlobal = code[addr + 1];
+        watchedValue = vm.globals[watchedGlobal];
+    }
+
+    if (lifted < 0 && !step && watchedGlobal < 0)
+    {
+        return;
+    }
+
+    Flow flow = opcode > 0 && opcode < ByteCode::NUM_OPCODES ? ByteCode::flow[opcode] : FLOW_NEXT;
+
+    switch (flow)
+    {
+        case FLOW_BRANCH:
+            next.push_back(addr + ByteCode::size(opcode));
+            next.push_back(code[addr + 1]);
+            break;
+        case FLOW_JUMP:
+        case FLOW_CALL:
+            next.push_back(code[addr + 1]);
+            break;
+        case FLOW_RETURN:
+            // RET returns through the frame, INIT jumps to the address below its argument count
+            next.push_back(opcode == ByteCode::RET ? vm.stack[vm.fp] : vm.stack[vm.sp - 1]);
+            break;
+        case FLOW_STOP:
+            break;
+        default:
+            next.push_back(addr + ByteCode::size(opcode));
+            break;
+    }
+
+    // a successor equal to addr cannot be trapped without skipping the instruction itself
+    for (int site : next)
+    {
+        if (site != addr && site >= 0 && site < codeLength)
+        {
+            stepSites.insert(site);
+            patch(site);
+        }
+    }
+}
+
+/// @brief This function reads and runs debugger commands until the program should resume
+/// @param vm Reference to the VM
+/// @return Will return 'c' to continue, 's' to step or 'q' to quit
+char Debugger::prompt(mVM::VM& vm)
+{
+    string line;
+
+    while (true)
+    {
+        out << "(mdb) " << flush;
+
+        if (!getline(in, line))
+        {
+            interactive = false;
+            return 'c';
+        }
+
+        istringstream iss(line);
+        string cmd, arg;
+        iss >> cmd >> arg;
+
+        if (cmd == "c")
+        {
+            return 'c';
+        }
+        else if (cmd == "s")
+        {
+            return 's';
+        }
+        else if (cmd == "q")
+        {
+            return 'q';
+        }
+        else if (cmd == "b" || cmd == "d")
+        {
+            int addr = location(arg);
+            bool ok = cmd == "b" ? setBreakpoint(addr) : clearBreakpoint(addr);
+
+            if (!ok)
+            {
+                out << "no such location '" << arg << "'\n";
+            }
+        }
+        else if (cmd == "w" || cmd == "u")
+        {
+            int global = -1;
+
+            if (!number(arg, global) || global < 0 || global >= vm.numberOfGlobals)
+            {
+                out << "no such global '" << arg << "'\n";
+            }
+            else if (cmd == "w")
+            {
+                setWatchpoint(global);
+            }
+            else
+            {
+                clearWatchpoint(global);
+            }
+        }
+        else if (cmd == "bt")
+        {
+            backtrace(vm);
+        }
+        else if (cmd == "g")
+        {
+            dumpGlobals(vm, arg);
+        }
+        else if (cmd == "st")
+        {
+            vm.dumpStack();
+        }
+        else if (cmd == "l")
+        {
+            listPoints();
+        }
+        else
+        {
+            out << "c continue, s step, q quit, b/d <addr|label> set/delete breakpoint,\n"
+                << "w/u <global> set/delete watchpoint, bt frames, g [global] globals, st stack, l list\n";
+        }
+    }
+}
+
+/// @brief This function prints the frames by following the fp links
+/// @param vm Reference to the VM
+void Debugger::backtrace(mVM::VM& vm)
+{
+    int pc = vm.ip;
+    int fp = vm.fp;
+    int frame = 0;
+
+    // a frame holds the arguments, nargs, the saved fp and the return address, fp points at the latter
+    while (true)
+    {
+        out << "#" << frame++ << " ";
+        where(pc);
+
+        if (fp < 2)
+        {
+            break;
+        }
+
+        int nargs = vm.stack[fp - 2];
+        out << "    fp = " << fp << ", args = [";
+
+        for (int i = 0; i < nargs; i++)
+        {
+            out << (i > 0 ? "," : "") << vm.stack[fp - 2 - nargs + i];
+        }
+
+        out << "]\n";
+
+        pc = vm.stack[fp];
+        fp = vm.stack[fp - 1];
+    }
+}
+
+/// @brief This function prints one or all globals
+/// @param vm Reference to the VM
+/// @param arg Reference to the global index, empty for all
+void Debugger::dumpGlobals(mVM::VM& vm, const string& arg)
+{
+    int first = 0;
+    int last = vm.numberOfGlobals - 1;
+
+    if (!arg.empty())
+    {
+        if (!number(arg, first) || first < 0 || first >= vm.numberOfGlobals)
+        {
+            out << "no such global '" << arg << "'\n";
+            return;
+        }
+
+        last = first;
+    }
+
+    for (int i = max(first, 0); i <= last && i < vm.numberOfGlobals; i++)
+    {
+        out << "g[" << i << "] = " << vm.globals[i] << "\n";
+    }
+}
+
+/// @brief This function lists the breakpoints and watchpoints
+void Debugger::listPoints()
+{
+    for (int addr : breakpoints)
+    {
+        out << "break ";
+        where(addr);
+    }
+
+    for (int global : watchpoints)
+    {
+        out << "watch g[" << global << "]\n";
+    }
+}
+
+/// @brief This function prints an address with its label and instruction
+/// @param addr This is the address
+void Debugger::where(int addr)
+{
+    out << setfill('0') << setw(4) << addr << setfill(' ');
+
+    for (const auto& label : labels)
+    {
+        if (label.second == addr)
+        {
+            out << " <" << label.first << ">";
+        }
+    }
+
+    if (addr < 0 || addr >= codeLength)
+    {
+        out << "\n";
+        return;
+    }
+
+    int opcode = opcodeAt(addr);
+
+    if (opcode > 0 && opcode < ByteCode::NUM_OPCODES)
+    {
+        out << ": " << ByteCode::opName[opcode];
+
+        for (int i = 1; i <= ByteCode::operands[opcode] && addr + i < codeLength; i++)
+        {
+            out << " " << code[addr + i];
+        }
+    }
+
+    out << "\n";
+}
+
+/// @brief This function sets a breakpoint
+/// @param addr This is the address
+/// @return Will return false if the address is not the start of an instruction
+bool Debugger::setBreakpoint(int addr)
+{
+    int ip = 0;
+
+    // patching an operand word would change the operand, so only instruction starts are accepted
+    while (ip < addr && ip < codeLength)
+    {
+        ip += ByteCode::size(opcodeAt(ip));
+    }
+
+    if (addr < 0 || addr >= codeLength || ip != addr)
+    {
+        return false;
+    }
+
+    breakpoints.insert(addr);
+    patch(addr);
+
+    return true;
+}
+
+/// @brief This function deletes a breakpoint
+/// @param addr This is the address
+/// @return Will return false if there is no breakpoint at the address
+bool Debugger::clearBreakpoint(int addr)
+{
+    if (breakpoints.erase(addr) == 0)
+    {
+        return false;
+    }
+
+    if (!wanted(addr))
+    {
+        unpatch(addr);
+    }
+
+    return true;
+}
+
+/// @brief This function sets a watchpoint by trapping every GSTORE to the global
+/// @param global This is the global index
+/// @return Will return true
+bool Debugger::setWatchpoint(int global)
+{
+    watchpoints.insert(global);
+
+    for (int ip = 0; ip < codeLength; ip += ByteCode::size(opcodeAt(ip)))
+    {
+        if (wanted(ip))
+        {
+            patch(ip);
+        }
+    }
+
+    return true;
+}
+
+/// @brief This function deletes a watchpoint
+/// @param global This is the global index
+/// @return Will return false if the global was not watched
+bool Debugger::clearWatchpoint(int global)
+{
+    if (watchpoints.erase(global) == 0)
+    {
+        return false;
+    }
+
+    for (int ip = 0; ip < codeLength; ip += ByteCode::size(opcodeAt(ip)))
+    {
+        if (opcodeAt(ip) == ByteCode::GSTORE && code[ip + 1] == global && !wanted(ip))
+        {
+            unpatch(ip);
+        }
+    }
+
+    return true;
+}
+
+/// @brief This function resolves an address or label
+/// @param loc Reference to the location
+/// @return Will return the address or -1 if unknown
+int Debugger::location(const string& loc) const
+{
+    int addr = -1;
+
+    if (!loc.empty() && isdigit(static_cast<unsigned char>(loc[0])))
+    {
+        return number(loc, addr) ? addr : -1;
+    }
+
+    auto it = labels.find(loc);
+
+    return it != labels.end() ? it->second : -1;
+}
+
+/// @brief This function parses a decimal number typed at the prompt
+/// @param text Reference to the text
+/// @param value Reference to the parsed value
+/// @return Will return false if the text is not a number or does not fit an int
+bool Debugger::number(const string& text, int& value)
+{
+    size_t end = 0;
+
+    try
+    {
+        value = stoi(text, &end);
+    }
+    catch (const exception&)
+    {
+        return false;
+    }
+
+    return end == text.size();
+}
+
+/// @brief This function returns the opcode at an address as it was before patching
+/// @param addr This is the address
+/// @return Will return the original opcode
+int Debugger::opcodeAt(int addr) const
+{
+    auto it = original.find(addr);
+
+    return it != original.end() ? it->second : code[addr];
+}
+
+/// @brief This function patches a BRK over the instruction at an address
+/// @param addr This is the address
+void Debugger::patch(int addr)
+{
+    if (original.count(addr) == 0)
+    {
+        original[addr] = code[addr];
+    }
+
+    code[addr] = ByteCode::BRK;
+}
+
+/// @brief This function restores the instruction at an address
+/// @param addr This is the address
+void Debugger::unpatch(int addr)
+{
+    auto it = original.find(addr);
+
+    if (it != original.end())
+    {
+        code[addr] = it->second;
+        original.erase(it);
+    }
+}
+
+/// @brief This function checks if an address has to trap
+/// @param addr This is the address
+/// @return Will return true for breakpoints, step sites and GSTOREs to watched globals
+bool Debugger::wanted(int addr) const
+{
+    if (breakpoints.count(addr) > 0 || stepSites.count(addr) > 0)
+    {
+        return true;
+    }
+
+    return opcodeAt(addr) == ByteCode::GSTORE && addr + 1 < codeLength && watchpoints.count(code[addr + 1]) > 0;
+}
\ No newline at end of file
@@ -0,0 +1,779 @@
+/**
+ * @file fuzz.cpp
+ * @author Adrian Goessl
+ * @brief This is the implementation of the differential fuzzer
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/fuzz.h"
+#include "../src/include/mVM.h"
+#include "../src/include/byteCode.h"
+#include "../src/include/debugger.h"
+
+#include <chrono>
+#include <sstream>
+
+using namespace FuzzInternals;
+using namespace ByteCodeInternals;
+using namespace std;
+
+
+/// @brief This is the constructor for the Generator class
+/// @param seed This is the seed of the random number generator
+Generator::Generator(unsigned int seed)
+    : rng(seed)
+{
+
+}
+
+/// @brief This function returns a random number
+/// @param lo This is the lower bound
+/// @param hi This is the upper bound, inclusive
+/// @return Will return the random number
+int Generator::pick(int lo, int hi)
+{
+    return uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+/// @brief This function generates a program that keeps the stack balanced, it ends at a HALT,
+/// at an array fault or at the instruction limit
+/// @return Will return the program
+Program Generator::generate()
+{
+    Program program;
+
+    for (int f = 0; f < NUM_FUNCTIONS; f++)
+    {
+        Node function{FUNCTION, {}, {1 + f % 2}, {}};
+        expression(function.code, 3, function.args[0]);
+        program.functions.push_back(function);
+    }
+
+    int statements = pick(1, 12);
+
+    for (int i = 0; i < statements; i++)
+    {
+        program.main.push_back(statement(0, 0));
+    }
+
+    return program;
+}
+
+/// @brief This function generates a branch free expression which pushes one value
+/// @param code Reference to the code to append to
+/// @param depth This is the remaining nesting depth
+/// @param nargs This is the number of arguments of the enclosing function
+void Generator::expression(vector<int>& code, int depth, int nargs)
+{
+    if (depth == 0 || pick(0, 2) == 0)
+    {
+        int leaf = pick(0, nargs > 0 ? 2 : 1);
+
+        if (leaf == 0)
+        {
+            code.insert(code.end(), {ByteCode::ICONST, pick(-9, 9)});
+        }
+        else if (leaf == 1)
+        {
+            code.insert(code.end(), {ByteCode::GLOAD, pick(0, NUM_GLOBALS - 1)});
+        }
+        else
+        {
+            // argument i of n lives at fp - 2 - n + i
+            code.insert(code.end(), {ByteCode::LOAD, pick(0, nargs - 1) - 2 - nargs});
+        }
+        return;
+    }
+
+    static const int ops[] = {ByteCode::IADD, ByteCode::ISUB, ByteCode::IMUL, ByteCode::ILT, ByteCode::IEQ};
+
+    expression(code, depth - 1, nargs);
+    expression(code, depth - 1, nargs);
+    code.push_back(ops[pick(0, 4)]);
+}
+
+/// @brief This function generates a statement, assignments never touch the array and loop counter globals
+/// @param depth This is the loop nesting depth
+/// @param nargs This is the number of arguments of the enclosing function
+/// @return Will return the statement
+Node Generator::statement(int depth, int nargs)
+{
+    Node node{STRAIGHT, {}, {}, {}};
+    int kind = pick(0, 11);
+
+    if (kind <= 2)
+    {
+        expression(node.code, 2, nargs);
+        node.code.insert(node.code.end(), {ByteCode::GSTORE, pick(0, ARRAY_GLOBAL - 1)});
+    }
+    else if (kind == 3)
+    {
+        expression(node.code, 2, nargs);
+        node.code.push_back(ByteCode::PRINT);
+    }
+    else if (kind == 4)
+    {
+        expression(node.code, 2, nargs);
+        node.code.push_back(ByteCode::POP);
+    }
+    else if (kind == 5)
+    {
+        int length = pick(1, 6);
+
+        // now and then an index is out of bounds or follows the loop counter past the end, so the
+        // error paths of the engines are compared as well, also after a loop went hot
+        auto index = [this, length, depth, &node]()
+        {
+            if (depth > 0 && pick(0, 3) == 0)
+            {
+                node.code.insert(node.code.end(), {ByteCode::GLOAD, COUNTER_GLOBAL + depth - 1});
+            }
+            else
+            {
+                int at = pick(0, 15) == 0 ? pick(-1, length + 1) : pick(0, length - 1);
+                node.code.insert(node.code.end(), {ByteCode::ICONST, at});
+            }
+        };
+
+        node.code.insert(node.code.end(), {ByteCode::ICONST, length, ByteCode::NEWARR, ByteCode::GSTORE, ARRAY_GLOBAL});
+        node.code.insert(node.code.end(), {ByteCode::GLOAD, ARRAY_GLOBAL});
+        index();
+        expression(node.code, 1, nargs);
+        node.code.push_back(ByteCode::ASTORE);
+        node.code.insert(node.code.end(), {ByteCode::GLOAD, ARRAY_GLOBAL});
+        index();
+        node.code.insert(node.code.end(), {ByteCode::ALOAD, ByteCode::PRINT});
+        node.code.insert(node.code.end(), {ByteCode::GLOAD, ARRAY_GLOBAL, ByteCode::ALEN, ByteCode::PRINT});
+        node.code.insert(node.code.end(), {ByteCode::GLOAD, ARRAY_GLOBAL, ByteCode::AFREE});
+    }
+    else if (kind == 6)
+    {
+        node.kind = IF;
+        expression(node.code, 2, nargs);
+
+        for (int i = pick(1, 3); i > 0; i--)
+        {
+            node.body.push_back(statement(depth, nargs));
+        }
+    }
+    else if (kind == 10)
+    {
+        // INIT with no arguments is a computed jump, here over code that never runs
+        node.kind = GOTO;
+        expression(node.code, 1, nargs);
+        node.code.push_back(ByteCode::PRINT);
+    }
+    else if (kind == 11 && pick(0, 3) == 0)
+    {
+        // a loop that only ends at the instruction limit, closed by BR or by an INIT
+        node.kind = SPIN;
+        node.args = {pick(0, ARRAY_GLOBAL - 1), pick(0, 1)};
+    }
+    else if (kind <= 8 && depth < MAX_LOOP_DEPTH)
+    {
+        node.kind = LOOP;
+        node.args = {COUNTER_GLOBAL + depth, pick(1, 40)};
+
+        for (int i = pick(1, 4); i > 0; i--)
+        {
+            node.body.push_back(statement(depth + 1, nargs));
+        }
+    }
+    else
+    {
+        int function = pick(0, NUM_FUNCTIONS - 1);
+        int args = 1 + function % 2;
+
+        node.kind = CALL;
+        node.args = {function, args, pick(-1, ARRAY_GLOBAL - 1)};
+
+        for (int i = 0; i < args; i++)
+        {
+            expression(node.code, 1, nargs);
+        }
+    }
+
+    return node;
+}
+
+/// @brief This function mutates the immediates of a program, code addresses and the argument count
+/// of an init are kept, init copies its arguments into the frame without bounds checks
+/// @param code Reference to the code
+void Generator::mutate(vector<int>& code)
+{
+    set<int> addresses = Fuzzer::addressOperands(code);
+
+    for (size_t ip = 0; ip < code.size(); ip += ByteCode::size(code[ip]))
+    {
+        bool initArguments = ip + 2 < code.size() && code[ip + 2] == ByteCode::INIT;
+
+        if (code[ip] == ByteCode::ICONST && ip + 1 < code.size() && addresses.count(static_cast<int>(ip) + 1) == 0
+            && !initArguments && pick(0, 3) == 0)
+        {
+            code[ip + 1] = pick(-9, 50);
+        }
+    }
+}
+
+/// @brief This is the constructor for the Fuzzer class
+/// @param _engines Reference to the engines, the first one is the reference
+Fuzzer::Fuzzer(const vector<Engine>& _engines)
+    : engines(_engines), millis(_engines.size(), 0.0), outcomes(_engines.size())
+{
+
+}
+
+/// @brief This function lays out a program, main starts at address 0 with a branch over the functions
+/// @param program Reference to the program
+/// @return Will return the code
+vector<int> Fuzzer::emit(const Program& program)
+{
+    vector<int> code = {ByteCode::BR, 0};
+    vector<int> entries;
+
+    for (const auto& function : program.functions)
+    {
+        entries.push_back(static_cast<int>(code.size()));
+        emit(function, code, entries);
+    }
+
+    code[1] = static_cast<int>(code.size());
+
+    for (const auto& node : program.main)
+    {
+        emit(node, code, entries);
+    }
+
+    code.push_back(ByteCode::HALT);
+
+    return code;
+}
+
+/// @brief This function lays out a statement
+/// @param node Reference to the statement
+/// @param code Reference to the code to append to
+/// @param entries Reference to the function addresses
+void Fuzzer::emit(const Node& node, vector<int>& code, const vector<int>& entries)
+{
+    code.insert(code.end(), node.code.begin(), node.code.end());
+
+    switch (node.kind)
+    {
+        case STRAIGHT:
+            break;
+        case IF:
+        {
+            code.insert(code.end(), {ByteCode::BRF, 0});
+            size_t patch = code.size() - 1;
+
+            for (const auto& child : node.body)
+            {
+                emit(child, code, entries);
+            }
+
+            code[patch] = static_cast<int>(code.size());
+            break;
+        }
+        case LOOP:
+        {
+            int counter = node.args[0];
+            code.insert(code.end(), {ByteCode::ICONST, 0, ByteCode::GSTORE, counter});
+            int head = static_cast<int>(code.size());
+
+            for (const auto& child : node.body)
+            {
+                emit(child, code, entries);
+            }
+
+            code.insert(code.end(), {ByteCode::GLOAD, counter, ByteCode::ICONST, 1, ByteCode::IADD, ByteCode::GSTORE, counter,
+                ByteCode::GLOAD, counter, ByteCode::ICONST, node.args[1], ByteCode::ILT, ByteCode::BRT, head});
+            break;
+        }
+        case CALL:
+            code.insert(code.end(), {ByteCode::CALL, entries[node.args[0]], node.args[1]});
+
+            if (node.args[2] < 0)
+            {
+                code.push_back(ByteCode::PRINT);
+            }
+            else
+            {
+                code.insert(code.end(), {ByteCode::GSTORE, node.args[2]});
+            }
+            break;
+        case FUNCTION:
+            code.push_back(ByteCode::RET);
+            break;
+        case GOTO:
+        {
+            int dead = static_cast<int>(code.size()) - static_cast<int>(node.code.size());
+            code.insert(code.begin() + dead, {ByteCode::ICONST, static_cast<int>(code.size()) + 5, ByteCode::ICONST, 0,
+                ByteCode::INIT});
+            break;
+        }
+        case SPIN:
+        {
+            int global = node.args[0];
+            int head = static_cast<int>(code.size());
+            code.insert(code.end(), {ByteCode::GLOAD, global, ByteCode::ICONST, 1, ByteCode::IADD, ByteCode::GSTORE, global});
+
+            if (node.args[1] == 0)
+            {
+                code.insert(code.end(), {ByteCode::BR, head});
+            }
+            else
+            {
+                code.insert(code.end(), {ByteCode::ICONST, head, ByteCode::ICONST, 0, ByteCode::INIT});
+            }
+            break;
+        }
+    }
+}
+
+/// @brief This function prints code in the assembler syntax of the Parser
+/// @param code Reference to the code
+/// @param entry This is the start address, marked with the label main
+/// @return Will return the listing
+string Fuzzer::listing(const vector<int>& code, int entry)
+{
+    ostringstream out;
+
+    for (size_t ip = 0; ip < code.size(); ip += ByteCode::size(code[ip]))
+    {
+        int opcode = code[ip];
+
+        if (entry != 0 && static_cast<int>(ip) == entry)
+        {
+            out << "main:\n";
+        }
+
+        if (opcode <= 0 || opcode >= ByteCode::NUM_OPCODES)
+        {
+            out << "// " << ip << ": invalid " << opcode << "\n";
+            continue;
+        }
+
+        out << ByteCode::opName[opcode];
+
+        for (int i = 1; i <= ByteCode::operands[opcode] && ip + i < code.size(); i++)
+        {
+            out << " " << code[ip + i];
+        }
+
+        out << "    // " << ip << "\n";
+    }
+
+    return out.str();
+}
+
+/// @brief This function runs code on one engine and captures what it printed
+/// @param code Reference to the code
+/// @param entry This is the start address
+/// @param engine Reference to the engine
+/// @return Will return the outcome
+Outcome Fuzzer::run(const vector<int>& code, int entry, const Engine& engine)
+{
+    vector<int> copy = code;
+    copy.push_back(ByteCode::HALT);
+    mVM::VM vm(copy.data(), static_cast<int>(code.size()), entry, NUM_GLOBALS, "");
+    vm.limits.maxInstructions = INSTRUCTION_LIMIT;
+    vm.limits.maxStackDepth = STACK_LIMIT;
+    vm.hotThreshold = engine.hotThreshold;
+
+    istringstream none;
+    ostringstream sink;
+    DebuggerInternals::Debugger debugger(none, sink, {});
+
+    if (engine.debug)
+    {
+        debugger.attach(vm);
+    }
+
+    ostringstream capture;
+    auto coutBuf = cout.rdbuf(capture.rdbuf());
+    auto cerrBuf = cerr.rdbuf(sink.rdbuf());
+
+    auto start = chrono::steady_clock::now();
+    vm.execute();
+    auto end = chrono::steady_clock::now();
+
+    cout.rdbuf(coutBuf);
+    cerr.rdbuf(cerrBuf);
+
+    Outcome outcome;
+    outcome.status = vm.status;
+    outcome.output = capture.str();
+    outcome.globals = vm.globals;
+    outcome.stack.assign(vm.stack.begin(), vm.stack.begin() + (vm.sp + 1));
+    outcome.millis = chrono::duration<double, milli>(end - start).count();
+
+    return outcome;
+}
+
+/// @brief This function runs code through every engine and compares against the reference
+/// @param code Reference to the code
+/// @param entry This is the start address
+/// @param timed This is true to add the run times to millis
+/// @return Will return the index of the first diverging engine or -1
+int Fuzzer::check(const vector<int>& code, int entry, bool timed)
+{
+    int diverging = -1;
+
+    for (size_t i = 0; i < engines.size(); i++)
+    {
+        outcomes[i] = run(code, entry, engines[i]);
+
+        if (timed)
+        {
+            millis[i] += outcomes[i].millis;
+        }
+
+        if (diverging < 0 && i > 0 && !(outcomes[i] == outcomes[0]))
+        {
+            diverging = static_cast<int>(i);
+        }
+    }
+
+    return diverging;
+}
+
+/// @brief This function counts the statements of main, including nested ones
+/// @param nodes Reference to the statements
+/// @return Will return the number of statements
+int Fuzzer::count(const vector<Node>& nodes)
+{
+    int n = 0;
+
+    for (const auto& node : nodes)
+    {
+        n += 1 + count(node.body);
+    }
+
+    return n;
+}
+
+/// @brief This function removes a statement by its preorder index
+/// @param nodes Reference to the statements
+/// @param index Reference to the index, counted down while searching
+/// @return Will return true if the statement was removed
+bool Fuzzer::remove(vector<Node>& nodes, int& index)
+{
+    for (auto it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        if (index-- == 0)
+        {
+            nodes.erase(it);
+            return true;
+        }
+
+        if (remove(it->body, index))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// @brief This function removes statements as long as the program still diverges
+/// @param program Reference to the diverging program
+/// @return Will return the smallest diverging program found
+Program Fuzzer::minimize(const Program& program)
+{
+    Program smallest = program;
+    int k = 0;
+
+    while (k < count(smallest.main))
+    {
+        Program candidate = smallest;
+        int index = k;
+        remove(candidate.main, index);
+
+        if (check(emit(candidate), 0, false) >= 0)
+        {
+            smallest = candidate;
+        }
+        else
+        {
+            k++;
+        }
+    }
+
+    check(emit(smallest), 0, false);
+
+    return smallest;
+}
+/// @brief This function returns the addresses of the instructions of code
+/// @param code Reference to the code
+/// @return Will return the instruction addresses in order
+vector<int> Fuzzer::instructions(const vector<int>& code)
+{
+    vector<int> starts;
+
+    for (size_t ip = 0; ip < code.size(); ip += ByteCode::size(code[ip]))
+    {
+        starts.push_back(static_cast<int>(ip));
+    }
+
+    return starts;
+}
+
+/// @brief This function finds the operands that hold code addresses, which are branch and call targets
+/// and the address pushed by 'iconst addr, iconst nargs, init'
+/// @param code Reference to the code
+/// @return Will return the positions of the operands
+set<int> Fuzzer::addressOperands(const vector<int>& code)
+{
+    vector<int> starts = instructions(code);
+    set<int> operands;
+
+    for (size_t i = 0; i < starts.size(); i++)
+    {
+        int ip = starts[i];
+        int opcode = code[ip];
+
+        if (opcode > 0 && opcode < ByteCode::NUM_OPCODES && ByteCode::target[opcode]
+            && ip + 1 < static_cast<int>(code.size()))
+        {
+            operands.insert(ip + 1);
+        }
+
+        if (opcode == ByteCode::INIT && i >= 2 && code[starts[i - 2]] == ByteCode::ICONST
+            && code[starts[i - 1]] == ByteCode::ICONST)
+        {
+            operands.insert(starts[i - 2] + 1);
+        }
+    }
+
+    return operands;
+}
+
+/// @brief This function checks if a run of instructions can be removed without changing the stack depth
+/// anywhere else, it has to be straight line code that leaves as many values on the stack as it found
+/// @param code Reference to the code
+/// @param from This is the address of the first instruction of the run
+/// @param to This is the address after the run
+/// @return Will return true if the run is balanced
+bool Fuzzer::balanced(const vector<int>& code, int from, int to)
+{
+    int depth = 0;
+
+    for (int ip = from; ip < to; ip += ByteCode::size(code[ip]))
+    {
+        int opcode = code[ip];
+
+        if (opcode <= 0 || opcode >= ByteCode::NUM_OPCODES || ByteCode::flow[opcode] != FLOW_NEXT
+            || ByteCode::pops[opcode] < 0)
+        {
+            return false;
+        }
+
+        depth += ByteCode::pushes[opcode] - ByteCode::pops[opcode];
+    }
+
+    return depth == 0;
+}
+
+/// @brief This function marks the instructions that can be reached from the entry, RET is assumed to
+/// return behind a CALL and INIT to jump to the address of 'iconst addr, iconst nargs, init'
+/// @param code Reference to the code
+/// @param entry This is the start address
+/// @return Will return a flag per code word, all set if a jump cannot be followed
+vector<bool> Fuzzer::reachable(const vector<int>& code, int entry)
+{
+    int length = static_cast<int>(code.size());
+    vector<bool> reached(code.size(), false);
+    vector<bool> starts(code.size(), false);
+    set<int> addresses = addressOperands(code);
+    vector<int> work = {entry};
+
+    for (int ip : instructions(code))
+    {
+        starts[ip] = true;
+    }
+
+    while (!work.empty())
+    {
+        int ip = work.back();
+        work.pop_back();
+
+        if (ip < 0 || ip >= length || reached[ip])
+        {
+            continue;
+        }
+
+        int opcode = code[ip];
+
+        if (!starts[ip] || opcode <= 0 || opcode >= ByteCode::NUM_OPCODES || ip + ByteCode::size(opcode) > length)
+        {
+            return vector<bool>(code.size(), true);
+        }
+
+        reached[ip] = true;
+        int next = ip + ByteCode::size(opcode);
+
+        switch (ByteCode::flow[opcode])
+        {
+            case FLOW_BRANCH:
+            case FLOW_CALL:
+                work.push_back(next);
+                work.push_back(code[ip + 1]);
+                break;
+            case FLOW_JUMP:
+                work.push_back(code[ip + 1]);
+                break;
+            case FLOW_RETURN:
+                if (opcode == ByteCode::INIT)
+                {
+                    if (ip < 4 || code[ip - 4] != ByteCode::ICONST || addresses.count(ip - 3) == 0)
+                    {
+                        return vector<bool>(code.size(), true);
+                    }
+
+                    work.push_back(code[ip - 3]);
+                }
+                break;
+            case FLOW_STOP:
+                break;
+            default:
+                work.push_back(next);
+                break;
+        }
+    }
+
+    return reached;
+}
+
+/// @brief This function removes a run of instructions and moves the code addresses behind it
+/// @param code Reference to the code
+/// @param from This is the address of the first instruction of the run
+/// @param to This is the address after the run
+/// @param entry Reference to the start address, moved as well
+/// @return Will return the shorter code
+vector<int> Fuzzer::cut(const vector<int>& code, int from, int to, int& entry)
+{
+    int length = to - from;
+    auto move = [&](int addr)
+    {
+        return addr >= to ? addr - length : (addr > from ? from : addr);
+    };
+
+    set<int> addresses = addressOperands(code);
+    vector<int> shorter;
+
+    for (int i = 0; i < static_cast<int>(code.size()); i++)
+    {
+        if (i < from || i >= to)
+        {
+            shorter.push_back(addresses.count(i) > 0 ? move(code[i]) : code[i]);
+        }
+    }
+
+    entry = move(entry);
+
+    return shorter;
+}
+
+/// @brief This function shrinks code as long as it still diverges. It cuts code that cannot be reached and
+/// branches to the next instruction, turns conditional branches into POPs and cuts balanced runs of instructions,
+/// halving the run length.
+/// Runs with a branch target inside are kept, so every remaining path sees the same stack depths
+/// @param code Reference to the diverging code
+/// @param entry Reference to the start address, updated to the one of the smallest code
+/// @return Will return the smallest diverging code found
+vector<int> Fuzzer::minimize(const vector<int>& code, int& entry)
+{
+    vector<int> smallest = code;
+    bool progress = true;
+
+    auto attempt = [&](const vector<int>& candidate, int candidateEntry)
+    {
+        if (check(candidate, candidateEntry, false) < 0)
+        {
+            return false;
+        }
+
+        smallest = candidate;
+        entry = candidateEntry;
+        return true;
+    };
+
+    while (progress)
+    {
+        progress = false;
+
+        vector<int> starts = instructions(smallest);
+        vector<bool> reached = reachable(smallest, entry);
+
+        for (size_t i = 0; i < starts.size() && !progress; i++)
+        {
+            size_t j = i;
+
+            while (j < starts.size() && !reached[starts[j]])
+            {
+                j++;
+            }
+
+            if (j > i)
+            {
+                int candidateEntry = entry;
+                int to = j < starts.size() ? starts[j] : static_cast<int>(smallest.size());
+                vector<int> candidate = cut(smallest, starts[i], to, candidateEntry);
+                progress = attempt(candidate, candidateEntry);
+                i = j;
+            }
+        }
+
+        for (size_t i = 0; i < starts.size() && !progress; i++)
+        {
+            int ip = starts[i];
+
+            if (smallest[ip] > 0 && smallest[ip] < ByteCode::NUM_OPCODES && ByteCode::flow[smallest[ip]] == FLOW_BRANCH
+                && ByteCode::pops[smallest[ip]] == 1 && ip + 1 < static_cast<int>(smallest.size()))
+            {
+                int candidateEntry = entry;
+                vector<int> candidate = cut(smallest, ip + 1, ip + 2, candidateEntry);
+                candidate[ip] = ByteCode::POP;
+                progress = attempt(candidate, candidateEntry);
+            }
+            else if (smallest[ip] == ByteCode::BR && ip + 1 < static_cast<int>(smallest.size())
+                && smallest[ip + 1] == ip + ByteCode::size(ByteCode::BR))
+            {
+                int candidateEntry = entry;
+                vector<int> candidate = cut(smallest, ip, ip + ByteCode::size(ByteCode::BR), candidateEntry);
+                progress = attempt(candidate, candidateEntry);
+            }
+        }
+
+        for (int n = static_cast<int>(starts.size()) / 2; n >= 1 && !progress; n /= 2)
+        {
+            set<int> addresses = addressOperands(smallest);
+
+            for (size_t i = 0; i + n <= starts.size() && !progress; i++)
+            {
+                int from = starts[i];
+                int to = i + n < starts.size() ? starts[i + n] : static_cast<int>(smallest.size());
+                bool inside = entry > from && entry < to;
+
+                for (int operand : addresses)
+                {
+                    inside = inside || (smallest[operand] > from && smallest[operand] < to);
+                }
+
+                if (!inside && balanced(smallest, from, to))
+                {
+                    int candidateEntry = entry;
+                    vector<int> candidate = cut(smallest, from, to, candidateEntry);
+                    progress = attempt(candidate, candidateEntry);
+                }
+            }
+        }
+    }
+
+    check(smallest, entry, false);
+
+    return smallest;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file fuzzMain.cpp
+ * @author Adrian Goessl
+ * @brief This is the main file for the differential fuzzer of the micro Virtual Machine
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "../src/include/fuzz.h"
+#include "../src/include/parser.h"
+
+using namespace std;
+using namespace FuzzInternals;
+
+
+/// @brief Show usage menu
+void showMenu()
+{
+    cout << "Usage: mVMFuzz [-n <programs>] [-r <seed>] [-m <mutants>] [corpus files...]\n";
+    cout << "Options:\n";
+    cout << "\t-n <programs>\t\tnumber of generated programs\n";
+    cout << "\t-r <seed>\t\tseed of the generator\n";
+    cout << "\t-m <mutants>\t\tmutants per corpus file\n";
+}
+
+/// @brief This function reports a divergence and writes the program to a file
+/// @param fuzzer Reference to the fuzzer holding the outcomes of the last check
+/// @param engine This is the index of the diverging engine
+/// @param code Reference to the diverging code
+/// @param entry This is the start address of the code
+/// @param name Reference to the name of the program
+void reportDivergence(const Fuzzer& fuzzer, int engine, const vector<int>& code, int entry, const string& name)
+{
+    const Outcome& expected = fuzzer.outcomes[0];
+    const Outcome& actual = fuzzer.outcomes[engine];
+    string fileName = "divergence_" + name + ".asm";
+
+    cout << "divergence in " << fuzzer.engines[engine].name << " on " << name << ", written to " << fileName << "\n";
+    cout << "\tstatus " << expected.status << " / " << actual.status
+         << ", output " << expected.output.size() << " / " << actual.output.size() << " bytes"
+         << ", stack " << expected.stack.size() << " / " << actual.stack.size()
+         << ", globals " << (expected.globals == actual.globals ? "equal" : "differ") << "\n";
+
+    ofstream fout(fileName);
+    fout << Fuzzer::listing(code, entry);
+}
+
+/// @brief The main function, which runs generated and mutated programs through every engine
+/// @param argc Number of arguments
+/// @param argv Array of arguments
+/// @return Will return 0 if all engines agree, 1 if a divergence was found
+int main(int argc, char* argv[])
+{
+    int programs = 1000;
+    int mutants = 20;
+    unsigned int seed = 1;
+    vector<string> corpus;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if (arg == "-n" && i < argc - 1)
+        {
+            programs = stoi(argv[++i]);
+        }
+        else if (arg == "-r" && i < argc - 1)
+        {
+            seed = static_cast<unsigned int>(stoul(argv[++i]));
+        }
+        else if (arg == "-m" && i < argc - 1)
+        {
+            mutants = stoi(argv[++i]);
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            showMenu();
+            return 0;
+        }
+        else
+        {
+            corpus.push_back(arg);
+        }
+    }
+
+    Fuzzer fuzzer({
+        {"interpreter", 0, false},
+        {"tier-1", 1, false},
+        {"tier-16", 16, false},
+        {"debugger", 0, true}
+    });
+    Generator generator(seed);
+    int divergences = 0;
+    int runs = 0;
+
+    for (int i = 0; i < programs; i++)
+    {
+        Program program = generator.generate();
+        int engine = fuzzer.check(Fuzzer::emit(program));
+        runs++;
+
+        if (engine >= 0)
+        {
+            divergences++;
+            vector<int> code = Fuzzer::emit(fuzzer.minimize(program));
+            int entry = 0;
+
+            if (fuzzer.check(code, 0, false) < 0)
+            {
+                code = Fuzzer::emit(program);
+            }
+
+            // the statements are gone, now shrink what is left instruction by instruction
+            code = fuzzer.minimize(code, entry);
+            int smallest = fuzzer.check(code, entry, false);
+
+            reportDivergence(fuzzer, smallest >= 0 ? smallest : engine, code, entry, to_string(seed) + "_" + to_string(i));
+        }
+    }
+
+    for (const auto& file : corpus)
+    {
+        array<int, ParserInternals::MAX_TOKENS_PER_FILE> token{};
+        int entry = 0;
+        int size = 0;
+
+        // the parser is chatty, keep its output out of the report
+        ostringstream quiet;
+        auto coutBuf = cout.rdbuf(quiet.rdbuf());
+
+        try
+        {
+            ParserInternals::Parser parser(file);
+            parser.parse(token);
+            entry = parser.getiaddr();
+            size = parser.getszToken();
+        }
+        catch (const exception& e)
+        {
+            cout.rdbuf(coutBuf);
+            cerr << "Skipping '" << file << "': " << e.what() << endl;
+            continue;
+        }
+
+        cout.rdbuf(coutBuf);
+
+        vector<int> original(token.begin(), token.begin() + size);
+
+        for (int m = 0; m <= mutants; m++)
+        {
+            vector<int> code = original;
+
+            if (m > 0)
+            {
+                generator.mutate(code);
+            }
+
+            int engine = fuzzer.check(code, entry);
+            runs++;
+
+            if (engine >= 0)
+            {
+                divergences++;
+                int smallestEntry = entry;
+                vector<int> smallest = fuzzer.minimize(code, smallestEntry);
+                int diverging = fuzzer.check(smallest, smallestEntry, false);
+
+                reportDivergence(fuzzer, diverging >= 0 ? diverging : engine, smallest, smallestEntry, to_string(runs));
+            }
+        }
+    }
+
+    cout << "\n\tprograms = " << runs << ", divergences = " << divergences << "\n";
+
+    for (size_t i = 0; i < fuzzer.engines.size(); i++)
+    {
+        double speedup = fuzzer.millis[i] > 0 ? fuzzer.millis[0] / fuzzer.millis[i] : 0;
+
+        cout << "\t" << left << setw(12) << fuzzer.engines[i].name << right << fixed << setprecision(3)
+             << setw(12) << fuzzer.millis[i] << " ms  speedup = " << speedup << "\n";
+    }
+
+    return divergences > 0 ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+/**
+ * @file heap.cpp
+ * @author Adrian Goessl
+ * @brief This is the implementation of the arena backed heap
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/heap.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+using namespace HeapInternals;
+using namespace std;
+
+
+/// @brief This is the constructor for the Heap class
+/// @param arenaSize This is the initial size of the arena in ints
+Heap::Heap(int arenaSize)
+    : arena(max(arenaSize, HEADER_SIZE + 1)), live(arena.size(), false), freeList(), top(1)
+{
+    freeList.fill(0);
+}
+
+/// @brief This function returns the size class for an array length
+/// @param length This is the length of the array
+/// @return Will return the log2 of the rounded up capacity
+int Heap::sizeClass(int length)
+{
+    int cls = 0;
+
+    while ((1 << cls) < length)
+    {
+        cls++;
+    }
+
+    return cls;
+}
+
+/// @brief This function allocates a zeroed array, reusing a freed block of the same size class if possible
+/// @param length This is the number of elements
+/// @return Will return the reference to the array, never 0
+int Heap::allocate(int length)
+{
+    if (length < 0 || length > (1 << (NUM_SIZE_CLASSES - 2)))
+    {
+        throw runtime_error("Invalid array length");
+    }
+
+    int cls = sizeClass(length);
+    int capacity = 1 << cls;
+    int ref = freeList[cls];
+
+    if (ref != 0)
+    {
+        freeList[cls] = arena[ref + HEADER_SIZE];
+    }
+    else
+    {
+        size_t needed = static_cast<size_t>(top) + HEADER_SIZE + capacity;
+
+        if (needed > static_cast<size_t>(INT_MAX))
+        {
+            throw runtime_error("Out of heap memory");
+        }
+
+        if (needed > arena.size())
+        {
+            arena.resize(min(max(needed, arena.size() * 2), static_cast<size_t>(INT_MAX)));
+            live.resize(arena.size(), false);
+        }
+
+        ref = top;
+        top = static_cast<int>(needed);
+    }
+
+    live[ref] = true;
+    arena[ref] = cls;
+    arena[ref + 1] = length;
+    fill_n(arena.begin() + ref + HEADER_SIZE, length, 0);
+
+    return ref;
+}
+
+/// @brief This function returns an array to the pool of its size class
+/// @param ref This is the reference to the array
+void Heap::release(int ref)
+{
+    check(ref);
+
+    int cls = arena[ref];
+    live[ref] = false;
+    arena[ref + 1] = -1;
+    arena[ref + HEADER_SIZE] = freeList[cls];
+    freeList[cls] = ref;
+}
+
+/// @brief This function drops every allocation, keeping the arena memory for the next run
+void Heap::reset()
+{
+    fill(live.begin(), live.begin() + top, false);
+    freeList.fill(0);
+    top = 1;
+}
+
+/// @brief This function loads an element of an array
+/// @param ref This is the reference to the array
+/// @param index This is the element index
+/// @return Will return the element value
+int Heap::load(int ref, int index) const
+{
+    checkIndex(ref, index);
+    return arena[ref + HEADER_SIZE + index];
+}
+
+/// @brief This function stores an element of an array
+/// @param ref This is the reference to the array
+/// @param index This is the element index
+/// @param value This is the value to store
+void Heap::store(int ref, int index, int value)
+{
+    checkIndex(ref, index);
+    arena[ref + HEADER_SIZE + index] = value;
+}
+
+/// @brief This function returns the length of an array
+/// @param ref This is the reference to the array
+/// @return Will return the number of elements
+int Heap::length(int ref) const
+{
+    check(ref);
+    return arena[ref + 1];
+}
+
+/// @brief This function checks that a reference is the start of a live array, the header
+/// is range checked as well so a corrupted block can never index outside of the arena
+/// @param ref This is the reference to the array
+void Heap::check(int ref) const
+{
+    if (ref < 1 || ref > top - HEADER_SIZE || !live[ref])
+    {
+        throw runtime_error("Invalid array reference");
+    }
+
+    int cls = arena[ref];
+    int length = arena[ref + 1];
+
+    if (cls < 0 || cls >= NUM_SIZE_CLASSES || length < 0 || length > (1 << cls)
+        || static_cast<size_t>(ref) + HEADER_SIZE + length > arena.size())
+    {
+        throw runtime_error("Corrupted array header");
+    }
+}
+
+/// @brief This function checks that an index is inside a live array
+/// @param ref This is the reference to the array
+/// @param index This is the element index
+void Heap::checkIndex(int ref, int index) const
+{
+    check(ref);
+
+    if (index < 0 || index >= arena[ref + 1])
+    {
+        throw runtime_error("Array index out of bounds");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/**
+ * @file assembler.h
+ * @author Adrian Goessl
+ * @brief This is the header file for the parallel assembler
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Namespace for the Assembler  \namespace AssemblerInternals
+namespace AssemblerInternals
+{
+    constexpr int CHUNK_FORMAT_VERSION = 1;
+
+    /// @brief Code of one input file, addresses are relative to the start of the file \struct Chunk
+    struct Chunk
+    {
+        std::string file;
+        std::uint64_t key;
+        std::vector<int> code;
+        std::map<std::string, int> labels;
+        std::vector<int> relocations;
+        std::vector<std::pair<int, std::string>> externs;
+    };
+
+    /// @brief Linked program \struct Image
+    struct Image
+    {
+        std::vector<int> code;
+        std::map<std::string, int> labels;
+        int entry;
+    };
+
+    /// @brief Class for the Assembler \class Assembler
+    /// Input files are encoded concurrently into chunks and then linked in the given order,
+    /// branch and call targets are relocated by the base of their chunk and labels that a
+    /// file does not define are looked up in the other files. Chunks are cached by a hash of their source, in memory and,
+    /// if a cache directory is set, on disk.
+    class Assembler
+    {
+    public:
+        Assembler(int _threads = 0, const std::string& _cacheDir = "");
+
+        Image assemble(const std::vector<std::string>& files);
+
+        static std::uint64_t hash(const std::string& source);
+        static Chunk encode(const std::string& file, const std::string& source);
+        static Image link(const std::vector<Chunk>& chunks);
+
+        std::atomic<int> hits;
+        std::atomic<int> misses;
+
+    private:
+        Chunk load(const std::string& file);
+        bool readCache(std::uint64_t key, Chunk& chunk);
+        void writeCache(const Chunk& chunk);
+        std::string cachePath(std::uint64_t key) const;
+
+        int threads;
+        std::string cacheDir;
+        std::map<std::uint64_t, Chunk> cache;
+        std::mutex cacheMutex;
+    };
+}
+
+#endif // ASSEMBLER_H
\ No newline at end of file
@@ -14,45 +14,154 @@
 #include <array>
 #include <fstream>
 
+/// @brief Opcode definition table, X(name, mnemonic, operands, pops, pushes, flow)
+/// pops/pushes of -1 mean the stack effect depends on the frame, flow names the successors
+/// of the instruction, for BRANCH, JUMP and CALL the first operand is a code address that
+/// has to be relocated when code moves. Every opcode needs a VM::exec<name> handler.
+#define MVM_OPCODES(X) \
+    X(IADD,   "iadd",   0,  2, 1, NEXT) \
+    X(ISUB,   "isub",   0,  2, 1, NEXT) \
+    X(IMUL,   "imul",   0,  2, 1, NEXT) \
+    X(ILT,    "ilt",    0,  2, 1, NEXT) \
+    X(IEQ,    "ieq",    0,  2, 1, NEXT) \
+    X(BR,     "br",     1,  0, 0, JUMP) \
+    X(BRT,    "brt",    1,  1, 0, BRANCH) \
+    X(BRF,    "brf",    1,  1, 0, BRANCH) \
+    X(ICONST, "iconst", 1,  0, 1, NEXT) \
+    X(LOAD,   "load",   1,  0, 1, NEXT) \
+    X(GLOAD,  "gload",  1,  0, 1, NEXT) \
+    X(STORE,  "store",  1,  1, 0, NEXT) \
+    X(GSTORE, "gstore", 1,  1, 0, NEXT) \
+    X(PRINT,  "print",  0,  1, 0, NEXT) \
+    X(POP,    "pop",    0,  1, 0, NEXT) \
+    X(HALT,   "halt",   0,  0, 0, STOP) \
+    X(CALL,   "call",   2,  0, 3, CALL) \
+    X(RET,    "ret",    0, -1, 1, RETURN) \
+    X(INIT,   "init",   0, -1, 0, RETURN) \
+    X(NEWARR, "newarr", 0,  1, 1, NEXT) \
+    X(ALOAD,  "aload",  0,  2, 1, NEXT) \
+    X(ASTORE, "astore", 0,  3, 0, NEXT) \
+    X(ALEN,   "alen",   0,  1, 1, NEXT) \
+    X(AFREE,  "afree",  0,  1, 0, NEXT) \
+    X(BRK,    "brk",    0,  0, 0, STOP)
+
 /// @brief Namespace for ByteCode  \namespace ByteCodeInternals
 namespace ByteCodeInternals
 {
     constexpr int MAX_TOKENS_PER_FILE = 1024;
     constexpr int DEFAULT_STACK_SIZE = 1000;
 
+    /// @brief Successors of an instruction
+    enum Flow
+    {
+        FLOW_NEXT,      // the following instruction
+        FLOW_BRANCH,    // the target or the following instruction
+        FLOW_JUMP,      // the target
+        FLOW_CALL,      // the target, with a new frame
+        FLOW_RETURN,    // an address taken from the stack
+        FLOW_STOP       // none
+    };
+
     /// @brief Class for ByteCode \class ByteCode
     class ByteCode
     {
     public:
         ByteCode() = default;
 
-        static constexpr int NUM_OPCODES = 20;
-        static std::array<const char*, NUM_OPCODES> opName;
-        static std::array<int, NUM_OPCODES> operands;
+#define MVM_OPCODE_ENUM(op, name, nops, pops, pushes, flow) op,
+#define MVM_OPCODE_COUNT(op, name, nops, pops, pushes, flow) + 1
+#define MVM_OPCODE_NAME(op, name, nops, pops, pushes, flow) name,
+#define MVM_OPCODE_OPERANDS(op, name, nops, pops, pushes, flow) nops,
+#define MVM_OPCODE_POPS(op, name, nops, pops, pushes, flow) pops,
+#define MVM_OPCODE_PUSHES(op, name, nops, pops, pushes, flow) pushes,
+#define MVM_OPCODE_FLOW(op, name, nops, pops, pushes, flow) FLOW_##flow,
 
         enum OpCode : unsigned short
         {
-            IADD = 1,
-            ISUB,
-            IMUL,
-            ILT,
-            IEQ,
-            BR,
-            BRT,
-            BRF,
-            ICONST,
-            LOAD,
-            GLOAD,
-            STORE,
-            GSTORE,
-            PRINT,
-            POP,
-            HALT,
-            CALL,
-            RET,
-            INIT
+            INVALID = 0,
+            MVM_OPCODES(MVM_OPCODE_ENUM)
         };
+
+        static constexpr int NUM_OPCODES = 1 MVM_OPCODES(MVM_OPCODE_COUNT);
+        static constexpr std::array<const char*, NUM_OPCODES> opName = {nullptr, MVM_OPCODES(MVM_OPCODE_NAME)};
+        static constexpr std::array<int, NUM_OPCODES> operands = {0, MVM_OPCODES(MVM_OPCODE_OPERANDS)};
+        static constexpr std::array<int, NUM_OPCODES> pops = {0, MVM_OPCODES(MVM_OPCODE_POPS)};
+        static constexpr std::array<int, NUM_OPCODES> pushes = {0, MVM_OPCODES(MVM_OPCODE_PUSHES)};
+        static constexpr std::array<Flow, NUM_OPCODES> flow = {FLOW_NEXT, MVM_OPCODES(MVM_OPCODE_FLOW)};
+        static constexpr std::array<bool, NUM_OPCODES> target = []()
+        {
+            std::array<bool, NUM_OPCODES> t{};
+
+            for (int i = 1; i < NUM_OPCODES; i++)
+            {
+                t[i] = flow[i] == FLOW_BRANCH || flow[i] == FLOW_JUMP || flow[i] == FLOW_CALL;
+            }
+
+            return t;
+        }();
+
+#undef MVM_OPCODE_ENUM
+#undef MVM_OPCODE_COUNT
+#undef MVM_OPCODE_NAME
+#undef MVM_OPCODE_OPERANDS
+#undef MVM_OPCODE_POPS
+#undef MVM_OPCODE_PUSHES
+#undef MVM_OPCODE_FLOW
+
+        /// @brief This function returns the size of an instruction in code words
+        /// @param opcode This is the opcode
+        /// @return Will return 1 plus the number of operands, or 1 for an invalid opcode
+        static constexpr int size(int opcode)
+        {
+            return (opcode > 0 && opcode < NUM_OPCODES) ? 1 + operands[opcode] : 1;
+        }
+
+        /// @brief This function checks the generated tables at compile time, the VM relies on no
+        /// instruction pushing more values than it has code words to bound its stack headroom
+        /// @return Will return true if every opcode has a unique mnemonic and a sane encoding
+        static constexpr bool consistent()
+        {
+            for (int i = 1; i < NUM_OPCODES; i++)
+            {
+                if (opName[i] == nullptr || operands[i] < 0 || operands[i] > 2 || pops[i] < -1 || pushes[i] < 0)
+                {
+                    return false;
+                }
+
+                if (target[i] && operands[i] == 0)
+                {
+                    return false;
+                }
+
+                if (pushes[i] - (pops[i] > 0 ? pops[i] : 0) > size(i))
+                {
+                    return false;
+                }
+
+                for (int j = 1; j < i; j++)
+                {
+                    const char* a = opName[i];
+                    const char* b = opName[j];
+
+                    while (*a && *a == *b)
+                    {
+                        a++;
+                        b++;
+                    }
+
+                    if (*a == *b)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
     };
+
+    static_assert(ByteCode::opName[0] == nullptr, "opcode 0 is reserved");
+    static_assert(ByteCode::consistent(), "opcode table is inconsistent");
 }
 
 
@@ -0,0 +1,73 @@
+/**
+ * @file debugger.h
+ * @author Adrian Goessl
+ * @brief This is the header file for the debugger
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mVM.h"
+
+/// @brief Namespace for the Debugger  \namespace DebuggerInternals
+namespace DebuggerInternals
+{
+    /// @brief Class for the Debugger \class Debugger
+    /// The debugger runs the VM on a copy of the code in which every breakpoint, every
+    /// GSTORE to a watched global and the successors of a stepped instruction are
+    /// patched to BRK, so the VM runs at full speed until one of them is reached.
+    class Debugger
+    {
+    public:
+        Debugger(std::istream& _in, std::ostream& _out, const std::map<std::string, int>& _labels);
+
+        void attach(mVM::VM& vm);
+        void trap(mVM::VM& vm);
+
+        bool setBreakpoint(int addr);
+        bool clearBreakpoint(int addr);
+        bool setWatchpoint(int global);
+        bool clearWatchpoint(int global);
+
+    private:
+        char prompt(mVM::VM& vm);
+        void resume(mVM::VM& vm, int addr, bool step);
+        void backtrace(mVM::VM& vm);
+        void dumpGlobals(mVM::VM& vm, const std::string& arg);
+        void listPoints();
+        void where(int addr);
+        int location(const std::string& loc) const;
+        static bool number(const std::string& text, int& value);
+        int opcodeAt(int addr) const;
+        void patch(int addr);
+        void unpatch(int addr);
+        bool wanted(int addr) const;
+
+        std::istream& in;
+        std::ostream& out;
+        std::map<std::string, int> labels;
+        std::vector<int> code;
+        std::map<int, int> original;
+        std::set<int> breakpoints;
+        std::set<int> watchpoints;
+        std::set<int> stepSites;
+        int codeLength;
+        int lifted;
+        int watchedGlobal;
+        int watchedValue;
+        bool stepping;
+        bool interactive;
+    };
+}
+
+#endif // DEBUGGER_H
\ No newline at end of file
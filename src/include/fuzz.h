@@ -0,0 +1,130 @@
+/**
+ * @file fuzz.h
+ * @author Adrian Goessl
+ * @brief This is the header file for the differential fuzzer
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+/// @brief Namespace for the differential Fuzzer  \namespace FuzzInternals
+namespace FuzzInternals
+{
+    constexpr int NUM_GLOBALS = 8;
+    constexpr int NUM_FUNCTIONS = 3;
+    constexpr int ARRAY_GLOBAL = 5;
+    constexpr int COUNTER_GLOBAL = 6;
+    constexpr int MAX_LOOP_DEPTH = 2;
+    constexpr long long INSTRUCTION_LIMIT = 250000;
+    constexpr int STACK_LIMIT = 256;
+
+    /// @brief Kind of a generated statement
+    enum NodeKind
+    {
+        STRAIGHT,
+        IF,
+        LOOP,
+        CALL,
+        FUNCTION,
+        GOTO,
+        SPIN
+    };
+
+    /// @brief Generated statement \struct Node
+    /// code holds the branch free part, args the kind specific parameters
+    struct Node
+    {
+        NodeKind kind;
+        std::vector<int> code;
+        std::vector<int> args;
+        std::vector<Node> body;
+    };
+
+    /// @brief Generated program, main starts at address 0 with a branch over the functions \struct Program
+    struct Program
+    {
+        std::vector<Node> functions;
+        std::vector<Node> main;
+    };
+
+    /// @brief Execution engine or optimization mode under test \struct Engine
+    struct Engine
+    {
+        std::string name;
+        int hotThreshold;
+        bool debug;
+    };
+
+    /// @brief Observable result of a run \struct Outcome
+    struct Outcome
+    {
+        int status;
+        std::string output;
+        std::vector<int> globals;
+        std::vector<int> stack;
+        double millis;
+
+        bool operator==(const Outcome& other) const
+        {
+            return status == other.status && output == other.output
+                && globals == other.globals && stack == other.stack;
+        }
+    };
+
+    /// @brief Class for the random program Generator \class Generator
+    class Generator
+    {
+    public:
+        Generator(unsigned int seed);
+
+        Program generate();
+        void mutate(std::vector<int>& code);
+
+    private:
+        Node statement(int depth, int nargs);
+        void expression(std::vector<int>& code, int depth, int nargs);
+        int pick(int lo, int hi);
+
+        std::mt19937 rng;
+    };
+
+    /// @brief Class for the Fuzzer, which runs programs through every engine and minimizes divergences \class Fuzzer
+    class Fuzzer
+    {
+    public:
+        Fuzzer(const std::vector<Engine>& _engines);
+
+        static std::vector<int> emit(const Program& program);
+        static std::string listing(const std::vector<int>& code, int entry = 0);
+        static std::set<int> addressOperands(const std::vector<int>& code);
+        static Outcome run(const std::vector<int>& code, int entry, const Engine& engine);
+
+        int check(const std::vector<int>& code, int entry = 0, bool timed = true);
+        Program minimize(const Program& program);
+        std::vector<int> minimize(const std::vector<int>& code, int& entry);
+
+        std::vector<Engine> engines;
+        std::vector<double> millis;
+        std::vector<Outcome> outcomes;
+
+    private:
+        static void emit(const Node& node, std::vector<int>& code, const std::vector<int>& entries);
+        static int count(const std::vector<Node>& nodes);
+        static bool remove(std::vector<Node>& nodes, int& index);
+        static std::vector<int> instructions(const std::vector<int>& code);
+        static bool balanced(const std::vector<int>& code, int from, int to);
+        static std::vector<bool> reachable(const std::vector<int>& code, int entry);
+        static std::vector<int> cut(const std::vector<int>& code, int from, int to, int& entry);
+    };
+}
+
+#endif // FUZZ_H
\ No newline at end of file
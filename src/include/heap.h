@@ -0,0 +1,56 @@
+/**
+ * @file heap.h
+ * @author Adrian Goessl
+ * @brief This is the header file for the arena backed heap
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <array>
+#include <vector>
+
+/// @brief Namespace for the Heap  \namespace HeapInternals
+namespace HeapInternals
+{
+    constexpr int DEFAULT_ARENA_SIZE = 4096;
+    constexpr int NUM_SIZE_CLASSES = 32;
+    constexpr int HEADER_SIZE = 2;
+
+    /// @brief Class for the arena backed Heap \class Heap
+    /// Arrays are bump allocated out of one arena and referenced by their offset,
+    /// so a reference stays valid when the arena grows. Freed arrays go to a pool
+    /// per power of two size class and are reused before the arena is bumped again.
+    /// A reference is only accepted if it is the start of a live allocation, so a
+    /// program cannot forge one from an array element.
+    class Heap
+    {
+    public:
+        Heap(int arenaSize = DEFAULT_ARENA_SIZE);
+
+        int allocate(int length);
+        void release(int ref);
+        void reset();
+
+        int load(int ref, int index) const;
+        void store(int ref, int index, int value);
+        int length(int ref) const;
+        int used() const {return top;}
+
+    private:
+        static int sizeClass(int length);
+        void check(int ref) const;
+        void checkIndex(int ref, int index) const;
+
+        std::vector<int> arena;
+        std::vector<bool> live;
+        std::array<int, NUM_SIZE_CLASSES> freeList;
+        int top;
+    };
+}
+
+#endif // HEAP_H
\ No newline at end of file
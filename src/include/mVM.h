@@ -19,10 +19,53 @@
 #include <vector>
 #include <functional>
  #include <iomanip>
+#include <chrono>
+#include <stdexcept>
+
+#include "heap.h"
+#include "tier.h"
+
+namespace DebuggerInternals
+{
+    class Debugger;
+}
 
 /// @brief Namespace for minimalistic Virtual Machine  \namespace mVM
 namespace mVM
 {
+    constexpr int TIME_CHECK_INTERVAL = 1024;
+
+    /// @brief Status of a finished run, also used as the exit code of the VM
+    enum RunStatus
+    {
+        RUN_OK = 0,
+        RUN_ERROR,
+        RUN_INSTRUCTION_LIMIT,
+        RUN_TIME_LIMIT,
+        RUN_STACK_LIMIT,
+        RUN_OUTPUT_LIMIT
+    };
+
+    /// @brief Per run resource limits, 0 means unlimited, except for the stack depth which is then DEFAULT_STACK_SIZE \struct Limits
+    struct Limits
+    {
+        long long maxInstructions = 0;
+        long long maxMillis = 0;
+        int maxStackDepth = 0;
+        long long maxOutputBytes = 0;
+    };
+
+    /// @brief Exception thrown by cpu() when a limit is exceeded \class LimitExceeded
+    class LimitExceeded : public std::runtime_error
+    {
+    public:
+        LimitExceeded(RunStatus _status, int _ip, const std::string& what)
+            : std::runtime_error(what), status(_status), ip(_ip) {}
+
+        RunStatus status;
+        int ip;
+    };
+
     /// @brief Class for VM \class VM
     class VM
     {
@@ -42,10 +85,13 @@ namespace mVM
         void handleCall(int addr, int nargs, std::vector<int>& stack, int& sp, int& fp, int& ip, int* code);
         void handleRet(int& sp, int& fp, int& ip, std::vector<int>& stack, int nargs);
         void handleInit(int addr, int nargs, std::vector<int>& stack, int& sp, int& fp, int& ip);
+        void report();
+        void reportTiers();
 
         int *code;
         std::vector<int> stack;
         std::vector<int> globals;
+        HeapInternals::Heap heap;
         int ip;
         int sp;
         int fp;
@@ -54,7 +100,40 @@ namespace mVM
 
         int arraySize;
         int numberOfGlobals;
+
+        Limits limits;
+        RunStatus status;
+        int stopIp;
+        long long executed;
+        long long outputBytes;
+
+        int hotThreshold;
+        std::vector<TierInternals::TierEvent> tierEvents;
+        double tierMillis;
+        double totalMillis;
+
+        DebuggerInternals::Debugger* debugger;
     private:
+        void dispatch(int opcode);
+
+#define MVM_OPCODE_HANDLER(op, name, nops, pops, pushes, flow) void exec##op();
+        void execINVALID();
+        MVM_OPCODES(MVM_OPCODE_HANDLER)
+#undef MVM_OPCODE_HANDLER
+
+        void branched(int site);
+        void checkpoint(int at);
+        void enterTier(int site, bool call);
+        void runRegion(const TierInternals::Region& region);
+
+        std::vector<int> hotness;
+        std::vector<int> regionAt;
+        std::vector<TierInternals::Region> regions;
+        bool tiered;
+
+        std::chrono::steady_clock::time_point startTime;
+        int checkpoints;
+        int stackDepth;
         std::string outFileName;
         std::ofstream fout;
     };
@@ -17,12 +17,25 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+#include <utility>
 
 /// @brief Namespace for Parser  \namespace ParserInternals
 namespace ParserInternals
 {
     constexpr int MAX_TOKENS_PER_FILE = 1024;
 
+    /// @brief Encoded source of one file, addresses are relative to the start of the file \struct Encoding
+    /// relocations are the operands holding a code address of the file, externs the operands
+    /// referring to a label that is not defined in the file
+    struct Encoding
+    {
+        std::vector<int> code;
+        std::map<std::string, int> labels;
+        std::vector<int> relocations;
+        std::vector<std::pair<int, std::string>> externs;
+    };
+
     /// @brief Class for Parser \class Parser
     class Parser
     {
@@ -30,9 +43,9 @@ namespace ParserInternals
         std::array<int, MAX_TOKENS_PER_FILE> token;
         std::string infilename;
         std::ifstream fin;
-        std::string lowercase(const std::string& opstring);
+        static std::string lowercase(const std::string& opstring);
 
-        int find(const std::string& opstr);
+        static int find(const std::string& opstr);
         void setiaddr(int i){iaddr = i;}
         void setszToken(int s){szToken = s;}
 
@@ -41,8 +54,10 @@ namespace ParserInternals
         int getiaddr() const {return iaddr;}							
         int getszToken() const {return szToken;}
         void parse(std::array<int, MAX_TOKENS_PER_FILE>& token);
+        static Encoding encode(std::istream& in, const std::string& name);
         int iaddr;								
         int szToken;	
+        std::map<std::string, int> labels;
     };
 }
 
@@ -0,0 +1,87 @@
+/**
+ * @file tier.h
+ * @author Adrian Goessl
+ * @brief This is the header file for the optimized execution tier
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#ifndef TIER_H
+#define TIER_H
+
+#include <vector>
+
+#include "byteCode.h"
+
+/// @brief Namespace for the optimized Tier  \namespace TierInternals
+namespace TierInternals
+{
+    constexpr int DEFAULT_HOT_THRESHOLD = 100;
+
+    /// @brief Superinstructions of the optimized tier, numbered after the plain opcodes
+    enum SuperOp : int
+    {
+        EXIT = ByteCodeInternals::ByteCode::NUM_OPCODES,
+        ADDI,
+        SUBI,
+        MULI,
+        LTI,
+        EQI,
+        LT_BRT,
+        LT_BRF,
+        EQ_BRT,
+        EQ_BRF,
+        LTI_BRT,
+        LTI_BRF,
+        EQI_BRT,
+        EQI_BRF,
+        GINC
+    };
+
+    /// @brief Pre-decoded instruction of a region \struct Inst
+    /// a holds the first operand, k an immediate, b the original branch address or -1,
+    /// target the index of the branch target inside the region or -1 to exit
+    struct Inst
+    {
+        int op;
+        int a;
+        int k;
+        int b;
+        int target;
+        int ip;
+        int count;
+    };
+
+    /// @brief Hot code range compiled for the optimized tier \struct Region
+    struct Region
+    {
+        int start;
+        int end;
+        std::vector<Inst> code;
+    };
+
+    /// @brief Record of a promotion to the optimized tier \struct TierEvent
+    struct TierEvent
+    {
+        int start;
+        int end;
+        int ops;
+        long long executed;
+        bool call;
+    };
+
+    /// @brief Class for the Tier compiler \class Tier
+    class Tier
+    {
+    public:
+        static Region compile(const int* code, int codeLength, int start, int end);
+        static int functionEnd(const int* code, int codeLength, int start);
+
+    private:
+        static int fuse(const int* code, int ip, int end, const std::vector<bool>& leader, Inst& inst);
+    };
+}
+
+#endif // TIER_H
\ No newline at end of file
@@ -12,10 +12,12 @@
 #include "../src/include/parser.h"
 #include "../src/include/byteCode.h"
 #include "../src/include/macroBase.h"
+#include "../src/include/debugger.h"
 
 using namespace mVM;
 using namespace ParserInternals;
 using namespace ByteCodeInternals;
+using namespace TierInternals;
 using namespace std;
 
 
@@ -26,9 +28,10 @@ using namespace std;
 /// @param dataSize This is the size of the data
 /// @param oFileName This is the output file name
 VM::VM(int* _code, int codeLength, int main, int dataSize, const string& oFileName)
-    : code(_code), arraySize(codeLength), numberOfGlobals(dataSize), ip(main),
-    globals(dataSize), stack(DEFAULT_STACK_SIZE), sp(-1), fp(-1), trace(false), outFileName(oFileName),
-    fout(oFileName.empty() ? ofstream() : ofstream(oFileName))
+    : code(_code), stack(DEFAULT_STACK_SIZE), globals(dataSize), ip(main), sp(-1), fp(-1), trace(false),
+    arraySize(codeLength), numberOfGlobals(dataSize), status(RUN_OK), stopIp(-1), executed(0), outputBytes(0),
+    hotThreshold(0), tierMillis(0), totalMillis(0), debugger(nullptr), tiered(false), checkpoints(0), stackDepth(0),
+    outFileName(oFileName), fout(oFileName.empty() ? ofstream() : ofstream(oFileName))
 {
 
 }
@@ -57,6 +60,8 @@ void VM::handleBinaryOp(function<int(int, int)> op)
 /// @param sp Reference to the stack pointer
 void VM::handleBrtBrf(int addr, bool cond, int& ip, vector<int>& stack, int& sp)
 {
+    addr = code[ip++];
+
     if (stack[sp--] == cond)
     {
         ip = addr;
@@ -71,6 +76,15 @@ void VM::handleBrtBrf(int addr, bool cond, int& ip, vector<int>& stack, int& sp)
 void VM::handlePrint(int rvalue, ofstream& fout, vector<int>& stack, int& sp)
 {
     rvalue = stack[sp--];
+
+    long long bytes = static_cast<long long>(to_string(rvalue).size()) + 1;
+
+    if (limits.maxOutputBytes && outputBytes + bytes > limits.maxOutputBytes)
+    {
+        throw LimitExceeded(RUN_OUTPUT_LIMIT, ip - 1, "Output limit exceeded");
+    }
+
+    outputBytes += bytes;
     
     if (fout.is_open()) 
     {
@@ -140,99 +154,506 @@ void VM::handleInit(int addr, int nargs, vector<int>& stack, int& sp, int& fp, i
     ip = addr;
 }
 
-/// @brief This function is the main CPU loop
-void VM::cpu() 
+/// @brief This function handles an opcode outside of the opcode table
+void VM::execINVALID()
 {
-    int addr = 0;
-    int offset;
-    int rvalue = 0;
-    int nargs = 0;
+    cerr << "Unknown opcode: " << code[ip - 1] << endl;
+    throw runtime_error("Unknown opcode");
+}
 
-    if (!outFileName.empty()) 
+/// @brief This function handles the IADD instruction
+void VM::execIADD()
+{
+    handleBinaryOp([](int a, int b) { return a + b; });
+}
+
+/// @brief This function handles the ISUB instruction
+void VM::execISUB()
+{
+    handleBinaryOp([](int a, int b) { return a - b; });
+}
+
+/// @brief This function handles the IMUL instruction
+void VM::execIMUL()
+{
+    handleBinaryOp([](int a, int b) { return a * b; });
+}
+
+/// @brief This function handles the ILT instruction
+void VM::execILT()
+{
+    handleBinaryOp([](int a, int b) { return a < b; });
+}
+
+/// @brief This function handles the IEQ instruction
+void VM::execIEQ()
+{
+    handleBinaryOp([](int a, int b) { return a == b; });
+}
+
+/// @brief This function handles the BR instruction
+void VM::execBR()
+{
+    int site = ip - 1;
+    ip = code[ip];
+    branched(site);
+}
+
+/// @brief This function handles the BRT instruction
+void VM::execBRT()
+{
+    int site = ip - 1;
+    handleBrtBrf(0, true, ip, stack, sp);
+    branched(site);
+}
+
+/// @brief This function handles the BRF instruction
+void VM::execBRF()
+{
+    int site = ip - 1;
+    handleBrtBrf(0, false, ip, stack, sp);
+    branched(site);
+}
+
+/// @brief This function handles the ICONST instruction
+void VM::execICONST()
+{
+    stack[++sp] = code[ip++];
+}
+
+/// @brief This function handles the LOAD instruction
+void VM::execLOAD()
+{
+    int offset = code[ip++];
+    stack[++sp] = stack[fp + static_cast<vector<int, allocator<int>>::size_type>(offset)];
+}
+
+/// @brief This function handles the GLOAD instruction
+void VM::execGLOAD()
+{
+    int offset = code[ip++];
+    stack[++sp] = globals[offset];
+}
+
+/// @brief This function handles the STORE instruction
+void VM::execSTORE()
+{
+    int offset = code[ip++];
+    stack[fp + static_cast<vector<int, allocator<int>>::size_type>(offset)] = stack[sp--];
+}
+
+/// @brief This function handles the GSTORE instruction
+void VM::execGSTORE()
+{
+    int offset = code[ip++];
+    globals[offset] = stack[sp--];
+}
+
+/// @brief This function handles the PRINT instruction
+void VM::execPRINT()
+{
+    handlePrint(0, fout, stack, sp);
+}
+
+/// @brief This function handles the POP instruction
+void VM::execPOP()
+{
+    --sp;
+}
+
+/// @brief This function handles the HALT instruction, the CPU loop stops before it
+void VM::execHALT()
+{
+
+}
+
+/// @brief This function handles the CALL instruction
+void VM::execCALL()
+{
+    int site = ip - 1;
+    checkpoint(site);
+    handleCall(0, 0, stack, sp, fp, ip, code);
+
+    if (tiered)
     {
-        fout.open(outFileName, ios::app);
-        if (!fout.is_open()) 
+        enterTier(site, true);
+    }
+}
+
+/// @brief This function handles the RET instruction
+void VM::execRET()
+{
+    int site = ip - 1;
+    handleRet(sp, fp, ip, stack, 0);
+
+    if (ip <= site)
+    {
+        checkpoint(site);
+    }
+}
+
+/// @brief This function handles the INIT instruction
+void VM::execINIT()
+{
+    int site = ip - 1;
+    handleInit(0, 0, stack, sp, fp, ip);
+    checkpoint(site);
+}
+
+/// @brief This function handles the NEWARR instruction
+void VM::execNEWARR()
+{
+    stack[sp] = heap.allocate(stack[sp]);
+}
+
+/// @brief This function handles the ALOAD instruction
+void VM::execALOAD()
+{
+    int index = stack[sp--];
+    stack[sp] = heap.load(stack[sp], index);
+}
+
+/// @brief This function handles the ASTORE instruction
+void VM::execASTORE()
+{
+    heap.store(stack[sp - 2], stack[sp - 1], stack[sp]);
+    sp -= 3;
+}
+
+/// @brief This function handles the ALEN instruction
+void VM::execALEN()
+{
+    stack[sp] = heap.length(stack[sp]);
+}
+
+/// @brief This function handles the AFREE instruction
+void VM::execAFREE()
+{
+    heap.release(stack[sp--]);
+}
+
+/// @brief This function handles the BRK instruction by handing over to the debugger
+void VM::execBRK()
+{
+    ip--;
+    executed--;
+
+    if (debugger == nullptr)
+    {
+        throw runtime_error("Breakpoint without debugger");
+    }
+
+    debugger->trap(*this);
+}
+
+/// @brief This function runs the handler of an opcode, the switch is generated from the opcode table
+/// so the compiler can turn it into a jump table and inline the handlers
+/// @param opcode This is the opcode, with ip already past it
+inline void VM::dispatch(int opcode)
+{
+#define MVM_OPCODE_CASE(op, name, nops, pops, pushes, flow) case ByteCode::op: exec##op(); break;
+
+    switch (opcode)
+    {
+        MVM_OPCODES(MVM_OPCODE_CASE)
+        default:
+            execINVALID();
+    }
+
+#undef MVM_OPCODE_CASE
+}
+
+/// @brief This function enforces the limits after a branch and promotes hot loops when it went backward
+/// @param site This is the address of the branch instruction
+void VM::branched(int site)
+{
+    if (ip <= site)
+    {
+        checkpoint(site);
+
+        if (tiered)
         {
-            cerr << "Failed to open '" << outFileName << "' file\n";
+            enterTier(site, false);
+        }
+    }
+}
+
+/// @brief This function enforces the resource limits, it is only called on CALL, INIT and on branches
+/// and returns that go backward, so a straight line segment may overshoot the instruction limit before it is caught
+/// @param at This is the address of the branch or call instruction
+void VM::checkpoint(int at)
+{
+    if (limits.maxInstructions && executed > limits.maxInstructions)
+    {
+        throw LimitExceeded(RUN_INSTRUCTION_LIMIT, at, "Instruction limit exceeded");
+    }
+
+    if (sp + 1 > stackDepth)
+    {
+        throw LimitExceeded(RUN_STACK_LIMIT, at, "Stack limit exceeded");
+    }
+
+    if (limits.maxMillis && (++checkpoints & (TIME_CHECK_INTERVAL - 1)) == 0)
+    {
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime);
+
+        if (elapsed.count() > limits.maxMillis)
+        {
+            throw LimitExceeded(RUN_TIME_LIMIT, at, "Time limit exceeded");
         }
     }
+}
 
-    int opcode = code[ip]; // why is pointer using wrong indexs?
+/// @brief This function counts how often a backward branch or CALL target is reached and runs it
+/// in the optimized tier once it is hot, it is called with ip already set to the target
+/// @param site This is the address of the branch or call instruction
+/// @param call This is true if the target is a function entry
+void VM::enterTier(int site, bool call)
+{
+    int start = ip;
 
-    while (opcode != ByteCode::HALT && ip < arraySize)
+    if (start < 0 || start >= arraySize)
     {
-        if (trace == 1) 
+        return;
+    }
+
+    if (regionAt[start] < 0)
+    {
+        if (++hotness[start] < hotThreshold)
         {
-            //disassemble(ip, opcode);
+            return;
         }
 
-        ip++;
-        switch (opcode) 
+        int end = call ? Tier::functionEnd(code, arraySize, start) : site;
+        regions.push_back(Tier::compile(code, arraySize, start, end));
+        regionAt[start] = static_cast<int>(regions.size()) - 1;
+
+        const Region& region = regions.back();
+        tierEvents.push_back(TierEvent{region.start, region.end, static_cast<int>(region.code.size()), executed, call});
+    }
+
+    runRegion(regions[regionAt[start]]);
+}
+
+/// @brief This function runs a compiled region until it branches out of it or reaches an EXIT
+/// @param region This is the compiled region
+void VM::runRegion(const Region& region)
+{
+    // the time is also recorded when a limit or an error leaves the region
+    struct Timer
+    {
+        double& millis;
+        chrono::steady_clock::time_point begin;
+
+        ~Timer()
+        {
+            millis += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        }
+    } timer{tierMillis, chrono::steady_clock::now()};
+
+    int cond = 0;
+    int pc = 0;
+
+    auto jump = [&](const Inst& in)
+    {
+        if (in.b <= in.ip)
+        {
+            checkpoint(in.ip);
+        }
+
+        if (in.target < 0)
+        {
+            ip = in.b;
+            pc = -1;
+        }
+        else
+        {
+            pc = in.target;
+        }
+    };
+
+    while (pc >= 0)
+    {
+        const Inst& in = region.code[pc++];
+        executed += in.count;
+
+        switch (in.op)
         {
             case ByteCode::IADD:
-                handleBinaryOp([](int a, int b) { return a + b; });
+                stack[sp - 1] = stack[sp - 1] + stack[sp];
+                sp--;
                 break;
             case ByteCode::ISUB:
-                handleBinaryOp([](int a, int b) { return a - b; });
+                stack[sp - 1] = stack[sp - 1] - stack[sp];
+                sp--;
                 break;
             case ByteCode::IMUL:
-                handleBinaryOp([](int a, int b) { return a * b; });
+                stack[sp - 1] = stack[sp - 1] * stack[sp];
+                sp--;
                 break;
             case ByteCode::ILT:
-                handleBinaryOp([](int a, int b) { return a < b; });
+                stack[sp - 1] = stack[sp - 1] < stack[sp];
+                sp--;
                 break;
             case ByteCode::IEQ:
-                handleBinaryOp([](int a, int b) { return a == b; });
+                stack[sp - 1] = stack[sp - 1] == stack[sp];
+                sp--;
                 break;
             case ByteCode::BR:
-                ip = code[ip];
+                jump(in);
                 break;
-            case ByteCode::BRT: 
-                handleBrtBrf(addr, true, ip, stack, sp);
+            case ByteCode::BRT:
+                if (stack[sp--] == true)
+                {
+                    jump(in);
+                }
                 break;
-            case ByteCode::BRF: 
-                handleBrtBrf(addr, false, ip, stack, sp);
+            case ByteCode::BRF:
+                if (stack[sp--] == false)
+                {
+                    jump(in);
+                }
                 break;
-            case ByteCode::ICONST: 
-                stack[++sp] = code[ip++];
+            case ByteCode::ICONST:
+                stack[++sp] = in.a;
                 break;
-            case ByteCode::LOAD: 
-                offset = code[ip++];
-                stack[++sp] = stack[fp + static_cast<vector<int, allocator<int>>::size_type>(offset)];
+            case ByteCode::LOAD:
+                stack[++sp] = stack[fp + static_cast<vector<int, allocator<int>>::size_type>(in.a)];
                 break;
             case ByteCode::GLOAD:
-                offset = code[ip++];
-                stack[++sp] = globals[offset];
+                stack[++sp] = globals[in.a];
                 break;
             case ByteCode::STORE:
-                offset = code[ip++];
-                stack[fp + static_cast<vector<int, allocator<int>>::size_type>(offset)] = stack[sp--];
+                stack[fp + static_cast<vector<int, allocator<int>>::size_type>(in.a)] = stack[sp--];
                 break;
             case ByteCode::GSTORE:
-                offset = code[ip++];
-                globals[offset] = stack[sp--];
-                break;
-            case ByteCode::PRINT:
-                handlePrint(rvalue, fout, stack, sp);
+                globals[in.a] = stack[sp--];
                 break;
             case ByteCode::POP:
                 --sp;
                 break;
-            case ByteCode::CALL: 
-                handleCall(addr, nargs, stack, sp, fp, ip, code);
+            case EXIT:
+                ip = in.ip;
+                pc = -1;
+                break;
+            case ADDI:
+                stack[sp] = stack[sp] + in.k;
+                break;
+            case SUBI:
+                stack[sp] = stack[sp] - in.k;
+                break;
+            case MULI:
+                stack[sp] = stack[sp] * in.k;
                 break;
-            case ByteCode::RET: 
-                handleRet(sp, fp, ip, stack, nargs);
+            case LTI:
+                stack[sp] = stack[sp] < in.k;
                 break;
-            case ByteCode::INIT:
-                handleInit(addr, nargs, stack, sp, fp, ip);
+            case EQI:
+                stack[sp] = stack[sp] == in.k;
                 break;
-            case ByteCode::HALT: 
+            case LT_BRT:
+            case LT_BRF:
+                cond = stack[sp - 1] < stack[sp];
+                sp -= 2;
+                if (cond == (in.op == LT_BRT))
+                {
+                    jump(in);
+                }
                 break;
-            default: 
-                cerr << "Unknown opcode: " << opcode << endl;
-                throw runtime_error("Unknown opcode");
+            case EQ_BRT:
+            case EQ_BRF:
+                cond = stack[sp - 1] == stack[sp];
+                sp -= 2;
+                if (cond == (in.op == EQ_BRT))
+                {
+                    jump(in);
+                }
+                break;
+            case LTI_BRT:
+            case LTI_BRF:
+                cond = stack[sp--] < in.k;
+                if (cond == (in.op == LTI_BRT))
+                {
+                    jump(in);
+                }
+                break;
+            case EQI_BRT:
+            case EQI_BRF:
+                cond = stack[sp--] == in.k;
+                if (cond == (in.op == EQI_BRT))
+                {
+                    jump(in);
+                }
+                break;
+            case GINC:
+                globals[in.a] = globals[in.a] + in.k;
+                break;
+            default:
+                if (in.op <= 0 || in.op >= ByteCode::NUM_OPCODES)
+                {
+                    cerr << "Unknown superinstruction: " << in.op << endl;
+                    throw runtime_error("Unknown superinstruction");
+                }
+
+                // an opcode without a fast path runs its interpreter handler on the original code
+                ip = in.ip + 1;
+                dispatch(in.op);
+                break;
+        }
+    }
+}
+
+/// @brief This function is the main CPU loop
+void VM::cpu() 
+{
+    if (!outFileName.empty()) 
+    {
+        fout.open(outFileName, ios::app);
+        if (!fout.is_open()) 
+        {
+            cerr << "Failed to open '" << outFileName << "' file\n";
         }
+    }
+
+    stopIp = -1;
+    executed = 0;
+    outputBytes = 0;
+    checkpoints = 0;
+    startTime = chrono::steady_clock::now();
+
+    tiered = hotThreshold > 0 && trace != 1 && debugger == nullptr;
+    tierEvents.clear();
+    regions.clear();
+    tierMillis = 0;
+
+    if (tiered)
+    {
+        hotness.assign(arraySize, 0);
+        regionAt.assign(arraySize, -1);
+    }
+
+    // ip only moves forward between two checkpoints and no instruction pushes more values than it has
+    // code words, see ByteCode::consistent(), so a segment pushes at most one value per code word.
+    // Without a limit the depth is the size of the default stack, which then grows by that headroom
+    stackDepth = limits.maxStackDepth ? limits.maxStackDepth : DEFAULT_STACK_SIZE;
+
+    if (stackDepth + arraySize + 1 > static_cast<int>(stack.size()))
+    {
+        stack.resize(static_cast<size_t>(stackDepth) + arraySize + 1);
+    }
+
+    int opcode = code[ip]; // why is pointer using wrong indexs?
+
+    while (opcode != ByteCode::HALT && ip < arraySize)
+    {
+        if (trace == 1) 
+        {
+            disassemble(ip, opcode);
+        }
+
+        ip++;
+        executed++;
+        dispatch(opcode);
 
         if (trace == 1) 
         {
@@ -244,11 +665,16 @@ void VM::cpu()
 
     if (trace == 1) 
     {
-        //disassemble(ip, code[ip]);
+        if (ip < arraySize)
+        {
+            disassemble(ip, code[ip]);
+        }
         dumpStack();
         dumpDataMem();
     }
 
+    status = RUN_OK;
+
     if (fout.is_open()) 
     {
         fout.close();
@@ -258,11 +684,67 @@ void VM::cpu()
 /// @brief This function executes the VM
 void VM::execute() 
 {
+    status = RUN_ERROR;
+
     try
     {
         cpu();
     }
+    catch (const LimitExceeded& e)
+    {
+        status = e.status;
+        stopIp = e.ip;
+        report();
+    }
     LOG_EXCEPTION_AND_CONTINUE("An error occurred while running the VM.");
+
+    heap.reset();
+    totalMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+/// @brief This function reports where and why a run was stopped by a limit
+void VM::report()
+{
+    const char* reason = "error";
+
+    switch (status)
+    {
+        case RUN_OK:
+            return;
+        case RUN_INSTRUCTION_LIMIT:
+            reason = "instruction limit";
+            break;
+        case RUN_TIME_LIMIT:
+            reason = "time limit";
+            break;
+        case RUN_STACK_LIMIT:
+            reason = "stack limit";
+            break;
+        case RUN_OUTPUT_LIMIT:
+            reason = "output limit";
+            break;
+        default:
+            break;
+    }
+
+    cerr << "VM stopped: " << reason << " exceeded at " << setfill('0') << setw(4) << stopIp
+         << " (opcode " << code[stopIp] << ") after " << executed << " instructions, sp = " << sp
+         << ", output = " << outputBytes << " bytes" << endl;
+}
+
+/// @brief This function reports the tier-up events and the time spent per tier
+void VM::reportTiers()
+{
+    cout << "\n\ttier-ups = " << tierEvents.size() << "\n";
+
+    for (const auto& event : tierEvents)
+    {
+        cout << "\t" << setfill('0') << setw(4) << event.start << "-" << setw(4) << event.end
+             << (event.call ? " call" : " loop") << ": " << event.ops << " ops after "
+             << event.executed << " instructions\n";
+    }
+
+    cout << "\tinterpreter = " << totalMillis - tierMillis << " ms, optimized = " << tierMillis << " ms\n";
 }
 
 /// @brief This function dumps the stack
@@ -288,12 +770,14 @@ void VM::dumpStack()
 /// @param opcode This is the opcode
 void VM::disassemble(int ip, int opcode) 
 {
-    cout << "Opcode: " << opcode << endl;
+    if (opcode <= 0 || opcode >= ByteCode::NUM_OPCODES)
+    {
+        cerr << "Unknown opcode: " << opcode << endl;
+        return;
+    }
 
-    //auto instr = ByteCode::opName[opcode];
-    auto instr = reinterpret_cast<const array<const char*, ByteCode::NUM_OPCODES>&>(ByteCode::opName)[opcode];
-    //auto nops = ByteCode::operands[opcode];
-    auto nops = reinterpret_cast<const array<int, ByteCode::NUM_OPCODES>&>(ByteCode::operands)[opcode];
+    auto instr = ByteCode::opName[opcode];
+    auto nops = ByteCode::operands[opcode];
     ostream& out = fout.is_open() ? fout : cout;
 
     out << setfill('0') << setw(4) << ip << ": " << setw(6) << instr;
@@ -306,7 +790,7 @@ void VM::disassemble(int ip, int opcode)
     {
         out << " " << code[ip + 1] << " " << code[ip + 2];
     }
-    else if (opcode != 14)
+    else if (opcode != ByteCode::PRINT)
     {
         out << "    ";
     }
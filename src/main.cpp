@@ -13,6 +13,10 @@
 
 #include "../src/include/mVM.h"
 #include "../src/include/parser.h"
+#include "../src/include/debugger.h"
+#include "../src/include/assembler.h"
+#include "../src/include/byteCode.h"
+#include "../src/include/macroBase.h"
 
 using namespace std;
 using namespace mVM;
@@ -21,23 +25,37 @@ using namespace mVM;
 /// @brief Show usage menu
 void showMenu()
 {
-    cout << "Usage: mVM <filename> [-d] [-s <datasize>] [-o <outputfile>]\n";
+    cout << "Usage: mVM <filename> [<filename>...] [-d] [-s <datasize>] [-o <outputfile>] [-n <count>] [-t <ms>] [-k <depth>] [-b <bytes>] [-j <threshold>] [-g] [-p <threads>] [-c <cachedir>]\n";
     cout << "Options:\n";
     cout << "\t-d\t\t\ttrace execution\n";
     cout << "\t-s <datasize>\t\tset data memory size\n";
     cout << "\t-o <outputfile>\t\toutput disassembly to file\n";
+    cout << "\t-n <count>\t\tlimit executed instructions\n";
+    cout << "\t-t <ms>\t\t\tlimit wall clock time\n";
+    cout << "\t-k <depth>\t\tlimit stack depth\n";
+    cout << "\t-b <bytes>\t\tlimit printed output\n";
+    cout << "\t-j <threshold>\t\tenable tiered execution of hot code\n";
+    cout << "\t-g\t\t\trun under the interactive debugger\n";
+    cout << "\t-p <threads>\t\tassembler threads for multiple files\n";
+    cout << "\t-c <cachedir>\t\tcache assembled files by content\n";
 }
 
 /// @brief The main function, which executes the minimalistic Virtual Machine
 /// @param argc Number of arguments
 /// @param argv Array of arguments
-/// @return Will return 0 if successful, -1 if failed
+/// @return Will return 0 if successful, -1 if failed, otherwise the mVM::RunStatus of the run
 int main(int argc, char* argv[])
 {
     int datasize = 0;
     string infile, outfile;
     bool boolTrace = false;
+    bool boolDebug = false;
     bool infileSet = false;
+    mVM::Limits limits;
+    int hotThreshold = 0;
+    int threads = 0;
+    string cacheDir;
+    vector<string> infiles;
 
     if (argc < 2)
     {
@@ -55,6 +73,7 @@ int main(int argc, char* argv[])
         {
             infile = arg;
             infileSet = true;
+            infiles.push_back(arg);
             continue;
         }
 
@@ -62,6 +81,10 @@ int main(int argc, char* argv[])
         {
             boolTrace = true;
         }
+        else if (arg == "-g")
+        {
+            boolDebug = true;
+        }
         else if (arg == "-s" && i < argc - 1)
         {
             datasize = stoi(argv[i + 1]);
@@ -72,6 +95,45 @@ int main(int argc, char* argv[])
             outfile = argv[i + 1];
             ++i;
         }
+        else if (arg == "-n" && i < argc - 1)
+        {
+            limits.maxInstructions = stoll(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-t" && i < argc - 1)
+        {
+            limits.maxMillis = stoll(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-k" && i < argc - 1)
+        {
+            limits.maxStackDepth = stoi(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-b" && i < argc - 1)
+        {
+            limits.maxOutputBytes = stoll(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-j" && i < argc - 1)
+        {
+            hotThreshold = stoi(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-p" && i < argc - 1)
+        {
+            threads = stoi(argv[i + 1]);
+            ++i;
+        }
+        else if (arg == "-c" && i < argc - 1)
+        {
+            cacheDir = argv[i + 1];
+            ++i;
+        }
+        else if (!arg.empty() && arg[0] != '-')
+        {
+            infiles.push_back(arg);
+        }
         else
         {
             showMenu();
@@ -79,20 +141,61 @@ int main(int argc, char* argv[])
         }
     }
 
-    array<int, ParserInternals::MAX_TOKENS_PER_FILE> bytecode;
+    vector<int> bytecode;
+    map<string, int> labels;
+    int entry = 0;
 
-    ParserInternals::Parser parser(infile);
-    parser.parse(bytecode);
+    if (infiles.size() > 1 || !cacheDir.empty())
+    {
+        AssemblerInternals::Assembler assembler(threads, cacheDir);
+        AssemblerInternals::Image image;
 
-    if (bytecode[0] == -1)
+        try
+        {
+            image = assembler.assemble(infiles);
+        }
+        LOG_EXCEPTION_AND_RETURN("Failed to assemble the input files.", -1);
+
+        cout << "Assembled " << infiles.size() << " files, " << assembler.hits << " from cache\n";
+
+        bytecode = move(image.code);
+        labels = move(image.labels);
+        entry = image.entry;
+    }
+    else
     {
-        return -1;
+        array<int, ParserInternals::MAX_TOKENS_PER_FILE> tokens{};
+
+        try
+        {
+            ParserInternals::Parser parser(infile);
+            parser.parse(tokens);
+
+            bytecode.assign(tokens.begin(), tokens.begin() + parser.getszToken());
+            labels = parser.labels;
+            entry = parser.getiaddr();
+        }
+        LOG_EXCEPTION_AND_RETURN("Failed to parse the input file.", -1);
     }
 
+    // the VM reads the opcode after the last instruction before it checks the code length
+    int codeLength = static_cast<int>(bytecode.size());
+    bytecode.push_back(ByteCodeInternals::ByteCode::HALT);
+
     auto start = chrono::high_resolution_clock::now();
 
-    auto vm = make_unique<mVM::VM>(bytecode.data(), parser.getszToken(), parser.getiaddr(), datasize, outfile);
+    auto vm = make_unique<mVM::VM>(bytecode.data(), codeLength, entry, datasize, outfile);
     vm->trace = boolTrace;
+    vm->limits = limits;
+    vm->hotThreshold = hotThreshold;
+
+    DebuggerInternals::Debugger debugger(cin, cout, labels);
+
+    if (boolDebug)
+    {
+        debugger.attach(*vm);
+    }
+
     vm->execute();
 
     auto end = chrono::high_resolution_clock::now();
@@ -103,7 +206,12 @@ int main(int argc, char* argv[])
         vm->dumpCodeMem();
     }
 
+    if (hotThreshold > 0)
+    {
+        vm->reportTiers();
+    }
+
     cout << "\n\tduration = " << duration.count() << " ms\n";
 
-    return 0;
+    return vm->status;
 }
\ No newline at end of file
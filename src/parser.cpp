@@ -13,21 +13,13 @@
 #include "../src/include/byteCode.h"
 #include "../src/include/macroBase.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace ParserInternals;
 using namespace ByteCodeInternals;
 
 
-array<const char*, ByteCode::NUM_OPCODES> ByteCode::opName = {
-    nullptr, "iadd", "isub", "imul", "ilt", "ieq", "br", "brt",
-    "brf", "iconst", "load", "gload", "store", "gstore",
-    "print", "pop", "halt", "call", "ret", "init"
-};
-
-array<int, ByteCode::NUM_OPCODES> ByteCode::operands = {
-    0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 2, 0, 0
-};
-
 /// @brief This is the constructor for the Parser class
 /// @param ifilename Reference to the input file name
 Parser::Parser(const string& ifilename)
@@ -50,16 +42,11 @@ Parser::Parser(const string& ifilename)
 /// @return Will return the opcode
 int Parser::find(const string& opstr)
 {
-    for (auto i = 0; i < ByteCodeInternals::ByteCode::opName.size(); i++)
-    {
-        if (i == 0)
-        {
-			continue;
-		}
-
-        cout << "opstr: " << opstr << " ByteCode::opName[i]: " << ByteCodeInternals::ByteCode::opName[i] << endl;
+    string lower = lowercase(opstr);
 
-        if (lowercase(opstr) == lowercase(ByteCodeInternals::ByteCode::opName[i]))
+    for (auto i = 1; i < ByteCodeInternals::ByteCode::NUM_OPCODES; i++)
+    {
+        if (lower == ByteCodeInternals::ByteCode::opName[i])
         {
             return i;
         }
@@ -77,12 +64,10 @@ string Parser::lowercase(const string& opstring)
 
     for (auto c : opstring) 
     {
-        cout << "c: " << c << endl;
-        lower += tolower(c);
-        cout << "lower: " << lower.back() << endl;
+        lower += static_cast<char>(tolower(static_cast<unsigned char>(c)));
     }
 
-    while (!lower.empty() && ispunct(lower.back()))
+    while (!lower.empty() && ispunct(static_cast<unsigned char>(lower.back())))
     {
         lower.pop_back();
     }
@@ -90,42 +75,134 @@ string Parser::lowercase(const string& opstring)
     return lower;
 }
 
-/// @brief This function parses the input file
-/// @return Will return the token array
-void Parser::parse(array<int, MAX_TOKENS_PER_FILE>& token)
+/// @brief This function encodes a source, it is shared by the parser and the assembler. A token ending
+/// in ':' defines a label which can be used as operand, '//' starts a comment and unknown tokens are skipped.
+/// Numeric branch and call targets are relative to the start of the source, labels that are not defined
+/// in it are left to the caller
+/// @param in Reference to the source stream
+/// @param name Reference to the name of the source, used in error messages
+/// @return Will return the encoding
+Encoding Parser::encode(istream& in, const string& name)
 {
+    Encoding encoding;
+    vector<pair<int, string>> references;
     string line;
-    int iaddr = 0;
+    int lineNumber = 0;
 
-    while (getline(fin, line))
+    while (getline(in, line))
     {
+        lineNumber++;
+
+        size_t comment = line.find("//");
+
+        if (comment != string::npos)
+        {
+            line.erase(comment);
+        }
+
         istringstream iss(line);
         string tok;
 
         while (iss >> tok)
         {
-            if (line.substr(0, 2) == "//")
+            if (tok.size() > 1 && tok.back() == ':')
             {
+                if (!encoding.labels.emplace(tok.substr(0, tok.size() - 1), static_cast<int>(encoding.code.size())).second)
+                {
+                    cerr << "Duplicate label '" << tok << "' in '" << name << "' line " << lineNumber << "\n";
+                    throw runtime_error("Duplicate label.");
+                }
                 continue;
             }
 
             int opcode = find(tok);
 
-            if (opcode != -1)
+            if (opcode == -1)
+            {
+                continue;
+            }
+
+            encoding.code.push_back(opcode);
+
+            for (int i = 0; i < ByteCodeInternals::ByteCode::operands[opcode]; i++)
             {
-                token[iaddr] = opcode;
-                iaddr++;
+                int at = static_cast<int>(encoding.code.size());
 
-                if (ByteCodeInternals::ByteCode::operands[opcode] > 0)
+                if (!(iss >> tok))
                 {
-                    iss >> tok;
-                    token[iaddr] = stoi(tok);
-                    iaddr++;
+                    cerr << "Missing operand of '" << ByteCodeInternals::ByteCode::opName[opcode] << "' in '"
+                         << name << "' line " << lineNumber << "\n";
+                    throw runtime_error("Missing operand.");
+                }
+
+                if (isalpha(static_cast<unsigned char>(tok[0])) || tok[0] == '_' || tok[0] == '.')
+                {
+                    references.emplace_back(at, tok);
+                    encoding.code.push_back(0);
+                    continue;
+                }
+
+                try
+                {
+                    encoding.code.push_back(stoi(tok));
+                }
+                catch (const exception&)
+                {
+                    cerr << "Invalid operand '" << tok << "' in '" << name << "' line " << lineNumber << "\n";
+                    throw runtime_error("Invalid operand.");
+                }
+
+                if (i == 0 && ByteCodeInternals::ByteCode::target[opcode])
+                {
+                    encoding.relocations.push_back(at);
                 }
             }
         }
     }
 
-    this->iaddr = iaddr;
-    this->szToken = iaddr;
+    for (const auto& reference : references)
+    {
+        auto it = encoding.labels.find(reference.second);
+
+        if (it != encoding.labels.end())
+        {
+            encoding.code[reference.first] = it->second;
+            encoding.relocations.push_back(reference.first);
+        }
+        else
+        {
+            encoding.externs.push_back(reference);
+        }
+    }
+
+    sort(encoding.relocations.begin(), encoding.relocations.end());
+
+    return encoding;
+}
+
+/// @brief This function parses the input file, execution starts at the label main or at address 0
+/// @return Will return the token array
+void Parser::parse(array<int, MAX_TOKENS_PER_FILE>& token)
+{
+    Encoding encoding = encode(fin, infilename);
+
+    if (!encoding.externs.empty())
+    {
+        cerr << "Unknown label '" << encoding.externs.front().second << "' in '" << infilename << "'\n";
+        throw runtime_error("Unknown label.");
+    }
+
+    if (encoding.code.size() > token.size())
+    {
+        cerr << "'" << infilename << "' has more than " << token.size() << " code words\n";
+        throw runtime_error("Input file too large.");
+    }
+
+    copy(encoding.code.begin(), encoding.code.end(), token.begin());
+    labels = encoding.labels;
+
+    auto entry = labels.find("main");
+
+    this->iaddr = entry != labels.end() ? entry->second : 0;
+    this->szToken = static_cast<int>(encoding.code.size());
 }
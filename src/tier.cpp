@@ -0,0 +1,189 @@
+/**
+ * @file tier.cpp
+ * @author Adrian Goessl
+ * @brief This is the implementation of the optimized tier compiler
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/tier.h"
+
+#include <algorithm>
+
+using namespace TierInternals;
+using namespace ByteCodeInternals;
+using namespace std;
+
+
+/// @brief This function finds the end of a function, which is its first RET or HALT
+/// @param code This is the code array
+/// @param codeLength This is the length of the code array
+/// @param start This is the address of the function
+/// @return Will return the address of the last instruction of the function
+int Tier::functionEnd(const int* code, int codeLength, int start)
+{
+    int ip = start;
+
+    while (ip < codeLength)
+    {
+        int next = ip + ByteCode::size(code[ip]);
+
+        if (code[ip] == ByteCode::RET || code[ip] == ByteCode::HALT || next >= codeLength)
+        {
+            return ip;
+        }
+
+        ip = next;
+    }
+
+    return codeLength - 1;
+}
+
+/// @brief This function compiles a code range into pre-decoded superinstructions
+/// @param code This is the code array
+/// @param codeLength This is the length of the code array
+/// @param start This is the address of the first instruction
+/// @param end This is the address of the last instruction
+/// @return Will return the compiled region, which always ends with an EXIT
+Region Tier::compile(const int* code, int codeLength, int start, int end)
+{
+    Region region{start, end, {}};
+    vector<bool> leader(codeLength, false);
+    vector<int> indexAt(codeLength, -1);
+    int ip = start;
+
+    while (ip <= end && ip + ByteCode::size(code[ip]) <= codeLength)
+    {
+        int opcode = code[ip];
+
+        if (opcode > 0 && opcode < ByteCode::NUM_OPCODES && ByteCode::target[opcode])
+        {
+            int addr = code[ip + 1];
+
+            if (addr >= start && addr <= end)
+            {
+                leader[addr] = true;
+            }
+        }
+
+        ip += ByteCode::size(opcode);
+    }
+
+    end = min(end, ip - 1);
+    ip = start;
+
+    while (ip <= end)
+    {
+        Inst inst{};
+        int words = fuse(code, ip, end, leader, inst);
+
+        indexAt[ip] = static_cast<int>(region.code.size());
+        region.code.push_back(inst);
+        ip += words;
+    }
+
+    region.code.push_back(Inst{EXIT, 0, 0, -1, -1, ip, 0});
+
+    for (auto& inst : region.code)
+    {
+        if (inst.b >= start && inst.b <= end)
+        {
+            inst.target = indexAt[inst.b];
+        }
+    }
+
+    return region;
+}
+
+/// @brief This function decodes the instruction at ip, merging it with its successors where a superinstruction fits
+/// @param code This is the code array
+/// @param ip This is the address of the instruction
+/// @param end This is the address of the last instruction of the region
+/// @param leader Marks the branch targets, which must stay the first instruction of a superinstruction
+/// @param inst Reference to the decoded instruction
+/// @return Will return the number of code words consumed
+int Tier::fuse(const int* code, int ip, int end, const vector<bool>& leader, Inst& inst)
+{
+    array<int, 5> at{};
+    array<int, 4> ops{};
+    int n = 0;
+
+    at[0] = ip;
+
+    while (n < 4 && at[n] <= end && (n == 0 || !leader[at[n]]))
+    {
+        ops[n] = code[at[n]];
+        at[n + 1] = at[n] + ByteCode::size(ops[n]);
+        n++;
+    }
+
+    auto isCompare = [](int op) { return op == ByteCode::ILT || op == ByteCode::IEQ; };
+    auto isBranch = [](int op) { return op == ByteCode::BRT || op == ByteCode::BRF; };
+
+    inst = Inst{ops[0], 0, 0, -1, -1, ip, 1};
+
+    if (n >= 4 && ops[0] == ByteCode::GLOAD && ops[1] == ByteCode::ICONST && ops[2] == ByteCode::IADD
+        && ops[3] == ByteCode::GSTORE && code[at[0] + 1] == code[at[3] + 1])
+    {
+        inst = Inst{GINC, code[at[0] + 1], code[at[1] + 1], -1, -1, ip, 4};
+        return at[4] - ip;
+    }
+
+    if (n >= 3 && ops[0] == ByteCode::ICONST && isCompare(ops[1]) && isBranch(ops[2]))
+    {
+        int op = ops[1] == ByteCode::ILT
+            ? (ops[2] == ByteCode::BRT ? LTI_BRT : LTI_BRF)
+            : (ops[2] == ByteCode::BRT ? EQI_BRT : EQI_BRF);
+        inst = Inst{op, 0, code[at[0] + 1], code[at[2] + 1], -1, at[2], 3};
+        return at[3] - ip;
+    }
+
+    if (n >= 2 && isCompare(ops[0]) && isBranch(ops[1]))
+    {
+        int op = ops[0] == ByteCode::ILT
+            ? (ops[1] == ByteCode::BRT ? LT_BRT : LT_BRF)
+            : (ops[1] == ByteCode::BRT ? EQ_BRT : EQ_BRF);
+        inst = Inst{op, 0, 0, code[at[1] + 1], -1, at[1], 2};
+        return at[2] - ip;
+    }
+
+    if (n >= 2 && ops[0] == ByteCode::ICONST)
+    {
+        int op = 0;
+
+        switch (ops[1])
+        {
+            case ByteCode::IADD: op = ADDI; break;
+            case ByteCode::ISUB: op = SUBI; break;
+            case ByteCode::IMUL: op = MULI; break;
+            case ByteCode::ILT: op = LTI; break;
+            case ByteCode::IEQ: op = EQI; break;
+            default: break;
+        }
+
+        if (op != 0)
+        {
+            inst = Inst{op, 0, code[at[0] + 1], -1, -1, ip, 2};
+            return at[2] - ip;
+        }
+    }
+
+    // control flow other than the plain branches leaves the region and runs in the interpreter
+    if (ops[0] <= 0 || ops[0] >= ByteCode::NUM_OPCODES
+        || (ByteCode::flow[ops[0]] != FLOW_NEXT && ops[0] != ByteCode::BR && !isBranch(ops[0])))
+    {
+        inst = Inst{EXIT, 0, 0, -1, -1, ip, 0};
+    }
+    else if (ByteCode::target[ops[0]])
+    {
+        inst.b = code[ip + 1];
+    }
+    else if (ByteCode::operands[ops[0]] > 0)
+    {
+        inst.a = code[ip + 1];
+    }
+
+    return at[1] - ip;
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+/**
+ * @file assemblerTest.cpp
+ * @author Adrian Goessl
+ * @brief This is the test of the assembler's relocation and linking
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/assembler.h"
+#include "../src/include/byteCode.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace AssemblerInternals;
+using namespace ByteCodeInternals;
+using namespace std;
+
+
+static int failures = 0;
+
+/// @brief This function records a failed expectation
+/// @param ok This is the result of the expectation
+/// @param what Reference to the description of the expectation
+static void expect(bool ok, const string& what)
+{
+    if (!ok)
+    {
+        cerr << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+/// @brief This function checks that linking the chunks throws
+/// @param chunks Reference to the chunks
+/// @param what Reference to the description of the expectation
+static void expectLinkError(const vector<Chunk>& chunks, const string& what)
+{
+    try
+    {
+        Assembler::link(chunks);
+        expect(false, what);
+    }
+    catch (const runtime_error&)
+    {
+    }
+}
+
+// calls a function of the other module and branches to a local label
+static const string moduleA =
+    "// entry module\n"
+    "main:\n"
+    "    iconst 3\n"
+    "    CALL square 1   // defined in the other module\n"
+    "    print,\n"
+    "    br end\n"
+    "end: halt\n";
+
+// numeric targets are relative to the start of the module
+static const string moduleB =
+    "square:\n"
+    "    load -3\n"
+    "    load -3\n"
+    "    imul\n"
+    "    ret\n"
+    "helper: br 6\n"
+    "    br main\n";
+
+int main()
+{
+    Chunk a = Assembler::encode("a.asm", moduleA);
+    Chunk b = Assembler::encode("b.asm", moduleB);
+
+    expect(a.code == vector<int>{ByteCode::ICONST, 3, ByteCode::CALL, 0, 1, ByteCode::PRINT, ByteCode::BR, 8, ByteCode::HALT},
+           "a.asm encodes to its relative code");
+    expect(a.relocations == vector<int>{7}, "a.asm relocates its local branch only");
+    expect(a.externs.size() == 1 && a.externs[0] == make_pair(3, string("square")), "a.asm leaves square to the linker");
+    expect(b.relocations == vector<int>{7}, "b.asm relocates its numeric branch");
+    expect(b.externs.size() == 1 && b.externs[0] == make_pair(9, string("main")), "b.asm leaves main to the linker");
+
+    Image image = Assembler::link({a, b});
+
+    expect(image.code.size() == a.code.size() + b.code.size(), "the image holds both modules");
+    expect(image.entry == 0, "the image starts at main");
+    expect(image.labels["square"] == 9 && image.labels["helper"] == 15, "labels of b.asm are moved by its base");
+    expect(image.code[1] == 3 && image.code[4] == 1, "plain operands are not relocated");
+    expect(image.code[3] == 9, "the call resolves to square in b.asm");
+    expect(image.code[7] == 8, "the local branch of a.asm keeps its address");
+    expect(image.code[16] == 15, "the numeric branch of b.asm is moved by its base");
+    expect(image.code[18] == 0, "the branch to main resolves into a.asm");
+
+    Image reversed = Assembler::link({b, a});
+
+    expect(reversed.entry == 10, "main is found after b.asm");
+    expect(reversed.code[7] == 6 && reversed.code[9] == 10, "b.asm keeps its addresses at base 0");
+    expect(reversed.code[11] == 3 && reversed.code[13] == 0, "a.asm calls square at address 0");
+    expect(reversed.code[17] == 18, "the local branch of a.asm is moved by its base");
+
+    // both modules loop on their own label of the same name
+    Chunk first = Assembler::encode("first.asm", "main:\n    call count 0\nloop: br loop\n");
+    Chunk second = Assembler::encode("second.asm", "count:\nloop: br loop\n    ret\n");
+    Image local = Assembler::link({first, second});
+
+    expect(local.code[1] == 5 && local.code[4] == 3, "the call and the first loop resolve in first.asm");
+    expect(local.code[6] == 5, "the loop of second.asm resolves in second.asm");
+    expect(local.labels["loop"] == 3, "the image lists the first definition of loop");
+
+    expectLinkError({a}, "a missing label is an error");
+    expectLinkError({a, b, Assembler::encode("c.asm", "main: halt\n")}, "a label used across files but defined twice is an error");
+    expectLinkError({first, second, Assembler::encode("c.asm", "main: halt\n")}, "two entry points are an error");
+
+    if (failures > 0)
+    {
+        cerr << failures << " expectations failed\n";
+        return 1;
+    }
+
+    cout << "All assembler tests passed\n";
+    return 0;
+}
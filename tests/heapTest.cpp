@@ -0,0 +1,117 @@
+/**
+ * @file heapTest.cpp
+ * @author Adrian Goessl
+ * @brief This is the test of the heap's reference and length checks
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright MIT 2024
+ *
+ */
+#include "../src/include/heap.h"
+#include "../src/include/mVM.h"
+#include "../src/include/parser.h"
+#include "../src/include/byteCode.h"
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace HeapInternals;
+using namespace ParserInternals;
+using namespace ByteCodeInternals;
+using namespace std;
+
+
+static int failures = 0;
+
+/// @brief This function records a failed expectation
+/// @param ok This is the result of the expectation
+/// @param what Reference to the description of the expectation
+static void expect(bool ok, const string& what)
+{
+    if (!ok)
+    {
+        cerr << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+/// @brief This function checks that an operation throws
+/// @param operation Reference to the operation
+/// @param what Reference to the description of the expectation
+static void expectThrow(const function<void()>& operation, const string& what)
+{
+    try
+    {
+        operation();
+        expect(false, what);
+    }
+    catch (const runtime_error&)
+    {
+    }
+}
+
+/// @brief This function runs a program in the interpreter
+/// @param source Reference to the source of the program, it may use one global
+/// @return Will return the status of the run
+static mVM::RunStatus run(const string& source)
+{
+    istringstream in(source);
+    vector<int> code = Parser::encode(in, "test").code;
+    int codeLength = static_cast<int>(code.size());
+
+    code.push_back(ByteCode::HALT);
+
+    mVM::VM vm(code.data(), codeLength, 0, 1, "");
+    vm.execute();
+
+    return vm.status;
+}
+
+int main()
+{
+    Heap heap;
+    int ref = heap.allocate(4);
+
+    heap.store(ref, 3, 7);
+    expect(heap.load(ref, 3) == 7 && heap.length(ref) == 4, "a live array can be used");
+
+    // element 0 and 1 look like the header of a one element array
+    heap.store(ref, 0, 0);
+    heap.store(ref, 1, 1);
+    expectThrow([&]() { heap.load(ref + HEADER_SIZE, 0); }, "a reference made from array data is rejected");
+    expectThrow([&]() { heap.release(ref + HEADER_SIZE); }, "an array made from array data cannot be freed");
+    expectThrow([&]() { heap.load(ref, 4); }, "an index past the end is rejected");
+    expectThrow([&]() { heap.load(0, 0); }, "the null reference is rejected");
+    expectThrow([&]() { heap.length(1 << 20); }, "a reference past the arena is rejected");
+
+    heap.release(ref);
+    expectThrow([&]() { heap.release(ref); }, "a second free of the same array is rejected");
+    expectThrow([&]() { heap.load(ref, 0); }, "a load after free is rejected");
+    expectThrow([&]() { heap.allocate(-1); }, "a negative length is rejected");
+    expectThrow([&]() { heap.allocate((1 << (NUM_SIZE_CLASSES - 2)) + 1); }, "a too large length is rejected");
+
+    expect(run("iconst 4 newarr gstore 0 gload 0 iconst 1 iconst 7 astore gload 0 iconst 1 aload print gload 0 afree")
+           == mVM::RUN_OK, "a valid program runs");
+    expect(run("iconst 4 newarr iconst 2 iadd iconst 0 aload") == mVM::RUN_ERROR,
+           "ALOAD of a reference made from array data fails the run");
+    expect(run("iconst 4 newarr gstore 0 gload 0 afree gload 0 afree") == mVM::RUN_ERROR,
+           "a double AFREE fails the run");
+    expect(run("iconst 4 newarr gstore 0 gload 0 afree gload 0 iconst 0 aload") == mVM::RUN_ERROR,
+           "ALOAD after AFREE fails the run");
+    expect(run("iconst -1 newarr") == mVM::RUN_ERROR, "NEWARR of a negative length fails the run");
+    expect(run("iconst 1073741825 newarr") == mVM::RUN_ERROR, "NEWARR of a too large length fails the run");
+
+    if (failures > 0)
+    {
+        cerr << failures << " expectations failed\n";
+        return 1;
+    }
+
+    cout << "All heap tests passed\n";
+    return 0;
+}